@@ -0,0 +1,69 @@
+# Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+#
+# This file is part of the obake.py library.
+#
+# This Source Code Form is subject to the terms of the Mozilla
+# Public License v. 2.0. If a copy of the MPL was not distributed
+# with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+# Throughput of many small products of polynomials with
+# multiprecision coefficients, computed concurrently from 1..N
+# Python threads, with the system and the pooled allocators.
+# NOTE: the products release the GIL, and they are small enough
+# to be computed serially by each thread.
+
+import os
+import threading
+import time
+
+from obake import polynomial, make_polynomials, types, allocator, allocator_stats, reset_allocator_stats
+
+
+def worker(p, n_iter):
+    for _ in range(n_iter):
+        r = p * p
+        r = r - 1
+
+
+def run(p, n_threads, n_iter):
+    threads = [threading.Thread(target=worker, args=(p, n_iter))
+               for _ in range(n_threads)]
+
+    start = time.perf_counter()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return time.perf_counter() - start
+
+
+def main():
+    n_iter = 200
+    max_threads = os.cpu_count() or 1
+
+    for cf in [types.integer, types.rational]:
+        pt = polynomial[types.packed_monomial, cf]
+        x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+        # NOTE: the coefficients are large enough to
+        # bypass the limb caches of mp++.
+        p = (2**1000 * x + 3**600 * y - z + 1)**4
+
+        n_threads = 1
+        while True:
+            res = []
+            for name in ['system', 'pooled']:
+                with allocator(name):
+                    reset_allocator_stats()
+                    elapsed = run(p, n_threads, n_iter)
+                    stats = allocator_stats()
+                res.append("{}: {:.3f}s ({:.0f} products/s, {} pool hits)".format(
+                    name, elapsed, n_threads * n_iter / elapsed, stats['pool_hits']))
+            print("cf={}, threads={}: {}".format(cf, n_threads, ", ".join(res)))
+
+            if n_threads == max_threads:
+                break
+            n_threads = min(2 * n_threads, max_threads)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,55 @@
+# Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+#
+# This file is part of the obake.py library.
+#
+# This Source Code Form is subject to the terms of the Mozilla
+# Public License v. 2.0. If a copy of the MPL was not distributed
+# with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+# Sparse vs dense (FFT-based) multiplication of random
+# bivariate polynomials, sweeping over the fraction of the
+# dense representation which is populated by terms.
+
+import random
+import time
+
+from obake import polynomial, make_polynomials, mul, types
+
+
+def random_poly(pt, x, y, deg, density, integral, rng):
+    ret = pt()
+    for i in range(deg + 1):
+        for j in range(deg + 1):
+            if rng.random() < density:
+                c = rng.randint(-100, 100) if integral else rng.uniform(-1, 1)
+                ret += c * x**i * y**j
+    return ret
+
+
+def timeit(a, b, method):
+    start = time.perf_counter()
+    res = mul(a, b, method)
+    return time.perf_counter() - start, len(res)
+
+
+def main():
+    pt = polynomial[types.packed_monomial, types.double]
+    x, y = make_polynomials(pt, 'x', 'y')
+    rng = random.Random(42)
+
+    for deg in [50, 100, 200]:
+        for density in [.01, .05, .1, .25, .5, 1.]:
+            for integral in [True, False]:
+                a = random_poly(pt, x, y, deg, density, integral, rng)
+                b = random_poly(pt, x, y, deg, density, integral, rng)
+                res = ["deg={}, density={}, integral={}, terms={}x{}".format(
+                    deg, density, integral, len(a), len(b))]
+                for method in ['sparse', 'dense', 'auto']:
+                    elapsed, size = timeit(a, b, method)
+                    res.append("{}: {:.3f}s ({} terms)".format(
+                        method, elapsed, size))
+                print(", ".join(res))
+
+
+if __name__ == '__main__':
+    main()
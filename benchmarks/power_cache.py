@@ -0,0 +1,66 @@
+# Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+#
+# This file is part of the obake.py library.
+#
+# This Source Code Form is subject to the terms of the Mozilla
+# Public License v. 2.0. If a copy of the MPL was not distributed
+# with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+# Computation of the successive powers p, p**2, ..., p**n of a
+# polynomial via repeated __pow__ and via a PowerCache, with and
+# without truncation, and of a single truncated power via
+# __pow__ + truncate_degree() and via truncated_pow().
+
+import time
+
+from obake import polynomial, make_polynomials, types, PowerCache, truncated_pow, truncate_degree
+
+
+def successive_pow(p, n, max_degree):
+    start = time.perf_counter()
+    for i in range(1, n + 1):
+        r = p**i
+        if max_degree is not None:
+            truncate_degree(r, max_degree)
+    return time.perf_counter() - start
+
+
+def successive_cache(p, n, max_degree):
+    start = time.perf_counter()
+    pc = PowerCache(p, max_degree)
+    for i in range(1, n + 1):
+        pc[i]
+    return time.perf_counter() - start
+
+
+def single_pow(p, n, max_degree):
+    start = time.perf_counter()
+    r = p**n
+    truncate_degree(r, max_degree)
+    return time.perf_counter() - start
+
+
+def single_truncated_pow(p, n, max_degree):
+    start = time.perf_counter()
+    truncated_pow(p, n, max_degree)
+    return time.perf_counter() - start
+
+
+def main():
+    for cf in [types.double, types.integer]:
+        pt = polynomial[types.packed_monomial, cf]
+        x, y, z, t = make_polynomials(pt, 'x', 'y', 'z', 't')
+        p = 1 + x + y + z + t
+
+        for n in [10, 20, 30]:
+            for max_degree in [None, n // 2]:
+                print("cf={}, n={}, max_degree={}: __pow__ {:.3f}s, PowerCache {:.3f}s".format(
+                    cf, n, max_degree, successive_pow(p, n, max_degree), successive_cache(p, n, max_degree)))
+
+            max_degree = n // 2
+            print("cf={}, n={}, max_degree={}: single __pow__ {:.3f}s, truncated_pow {:.3f}s".format(
+                cf, n, max_degree, single_pow(p, n, max_degree), single_truncated_pow(p, n, max_degree)))
+
+
+if __name__ == '__main__':
+    main()
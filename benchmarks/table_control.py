@@ -0,0 +1,46 @@
+# Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+#
+# This file is part of the obake.py library.
+#
+# This Source Code Form is subject to the terms of the Mozilla
+# Public License v. 2.0. If a copy of the MPL was not distributed
+# with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+# Incremental build-up of a large series, with and
+# without pre-sizing the table.
+
+import time
+
+from obake import polynomial, make_polynomials, types
+
+
+def build(pt, x, y, z, n, reserve, n_segments):
+    acc = pt()
+    if n_segments is not None:
+        acc.set_n_segments(n_segments)
+    if reserve:
+        acc.reserve(n * n)
+
+    start = time.perf_counter()
+    for i in range(n):
+        acc += (x**i) * (y + z)**(n - 1)
+    elapsed = time.perf_counter() - start
+
+    return elapsed, len(acc)
+
+
+def main():
+    for cf in [types.double, types.integer]:
+        pt = polynomial[types.packed_monomial, cf]
+        x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+
+        for n in [100, 200, 400]:
+            for reserve in [False, True]:
+                for n_segments in [None, 4]:
+                    elapsed, size = build(pt, x, y, z, n, reserve, n_segments)
+                    print("cf={}, n={}, terms={}, reserve={}, n_segments={}: {:.3f}s".format(
+                        cf, n, size, reserve, n_segments, elapsed))
+
+
+if __name__ == '__main__':
+    main()
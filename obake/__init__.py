@@ -13,6 +13,8 @@ from .core import *
 # And we explicitly import the test submodule
 from . import test
 
+import concurrent.futures as _cf
+
 
 def make_polynomials(t, *args, **kwargs):
     from .core import _make_polynomials
@@ -78,3 +80,423 @@ def evaluate(x, d):
 
     t = _check_subs_eval_map(d)
     return _evaluate(t(), x, d)
+
+
+def evaluate_many(polys, d, as_array=False):
+    from .core import _evaluate_many
+
+    polys = list(polys)
+
+    if len(polys) == 0:
+        ret = []
+    else:
+        for p in polys:
+            if type(p) != type(polys[0]):
+                raise TypeError(
+                    "all the polynomials passed to evaluate_many() must be of the same type, but polynomials of type {} and {} were encountered instead".format(type(polys[0]), type(p)))
+
+        t = _check_subs_eval_map(d)
+        ret = _evaluate_many(t(), polys[0], polys, d)
+
+    if as_array:
+        import numpy as np
+
+        return np.array(ret)
+
+    return ret
+
+
+def specialize(x, d):
+    from .core import _specialize
+
+    t = _check_subs_eval_map(d)
+    return _specialize(t(), x, d)
+
+
+def specialize_many(x, ds):
+    from .core import _specialize_many
+
+    ds = list(ds)
+
+    if len(ds) == 0:
+        return []
+
+    t = _check_subs_eval_map(ds[0])
+    for d in ds[1:]:
+        cur_t = _check_subs_eval_map(d)
+        if cur_t != t:
+            raise TypeError(
+                "the values in the evaluation maps passed to specialize_many() must be all of the same type, but values of type {} and {} were encountered instead".format(t, cur_t))
+
+    return _specialize_many(t(), x, ds)
+
+
+def align(polys, ss=None):
+    from .core import _align
+
+    polys = list(polys)
+
+    if len(polys) == 0:
+        return [] if ss is None else sorted(set(ss))
+
+    for p in polys:
+        if type(p) != type(polys[0]):
+            raise TypeError(
+                "all the polynomials passed to align() must be of the same type, but polynomials of type {} and {} were encountered instead".format(type(polys[0]), type(p)))
+
+    return _align(polys[0], polys, ss)
+
+
+class _future(_cf.Future):
+    # Future returned by the asynchronous
+    # operations. In addition to the
+    # concurrent.futures interface, it can
+    # be awaited from asyncio.
+    def __await__(self):
+        import asyncio
+
+        return asyncio.wrap_future(self).__await__()
+
+
+# The set of asynchronous operations
+# which are still running.
+_async_pending = set()
+
+
+def _async_done(fut):
+    _async_pending.discard(fut)
+
+
+def _async_wait_pending():
+    # Wait for the completion of the pending
+    # asynchronous operations, so that the
+    # interpreter is not finalised while they
+    # are still running.
+    _cf.wait(list(_async_pending))
+
+
+def _async_submit(f, *args):
+    fut = _future()
+    fut.set_running_or_notify_cancel()
+
+    # NOTE: the input arguments are copied at submission,
+    # thus they can be modified in-place while the
+    # operation is running.
+    _async_pending.add(fut)
+    fut.add_done_callback(_async_done)
+
+    try:
+        f(*args, fut)
+    except:
+        _async_pending.discard(fut)
+        raise
+
+    return fut
+
+
+def mul(a, b, method='auto'):
+    from .core import _mul
+
+    if type(a) != type(b):
+        raise TypeError(
+            "the operands of mul() must be polynomials of the same type, but polynomials of type {} and {} were passed instead".format(type(a), type(b)))
+
+    return _mul(a, b, method)
+
+
+def mul_out_of_core(a, b, memory_budget, path=None, max_degree=None, min_abs_cf=None):
+    import os
+    import tempfile
+    from .core import _mul_out_of_core
+
+    if type(a) != type(b):
+        raise TypeError(
+            "the operands of mul_out_of_core() must be polynomials of the same type, but polynomials of type {} and {} were passed instead".format(type(a), type(b)))
+
+    # NOTE: the partitions are always stored in a new directory (created
+    # within path, if provided), so that the products written into the same
+    # path do not overwrite each other. If no path is provided, the directory
+    # is temporary and it is removed together with the disk polynomial.
+    temporary = path is None
+    if not temporary:
+        os.makedirs(path, exist_ok=True)
+    dir = tempfile.mkdtemp(prefix='obake_', dir=path)
+
+    try:
+        return _mul_out_of_core(a, b, dir, temporary, memory_budget, max_degree, min_abs_cf)
+    except:
+        import shutil
+
+        shutil.rmtree(dir, ignore_errors=True)
+        raise
+
+
+def mul_async(a, b):
+    from .core import _mul_async
+
+    return _async_submit(_mul_async, a, b)
+
+
+def pow_async(p, n):
+    from .core import _pow_async
+
+    return _async_submit(_pow_async, p, n)
+
+
+def subs_async(x, d):
+    from .core import _subs_async
+
+    t = _check_subs_eval_map(d)
+    return _async_submit(_subs_async, t(), x, d)
+
+
+def export_shared_size(p):
+    from .core import _shared_export_size
+
+    return _shared_export_size(p)
+
+
+def export_shared(p, dest):
+    from .core import _shared_export, _shared_export_size
+    import mmap
+    import os
+
+    if isinstance(dest, (str, bytes, os.PathLike)):
+        # Export to a memory-mapped file.
+        size = _shared_export_size(p)
+        with open(dest, 'w+b') as f:
+            f.truncate(size)
+            with mmap.mmap(f.fileno(), size) as mm:
+                _shared_export(p, mm)
+    else:
+        # Export to a writable buffer (e.g., the buffer
+        # of a multiprocessing.shared_memory.SharedMemory).
+        _shared_export(p, dest)
+
+
+def attach_shared(src):
+    from .core import _shared_attach
+    import mmap
+    import os
+
+    if isinstance(src, (str, bytes, os.PathLike)):
+        # Attach to a read-only memory-mapped file.
+        # NOTE: the mapping stays valid after the
+        # file is closed.
+        with open(src, 'rb') as f:
+            mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        return _shared_attach(mm)
+    else:
+        # Attach to a buffer (e.g., the buffer of a
+        # multiprocessing.shared_memory.SharedMemory).
+        return _shared_attach(src)
+
+
+def to_sympy(p):
+    import sympy
+    from .core import _to_terms
+
+    syms, exps, cfs = _to_terms(p)
+    gens = [sympy.Symbol(s) for s in syms]
+    cfs = [sympy.sympify(c) for c in cfs]
+
+    if len(gens) == 0 or any(e < 0 for m in exps for e in m):
+        # NOTE: sympy's polynomials cannot represent
+        # negative exponents.
+        return sympy.Add(*[c * sympy.Mul(*[g**e for g, e in zip(gens, m)]) for m, c in zip(exps, cfs)])
+
+    return sympy.Poly.from_dict(dict(zip(exps, cfs)), *gens).as_expr()
+
+
+def _sympy_cf_to_py(c):
+    # Convert a sympy number into the closest
+    # Python type.
+    if c.is_Integer:
+        return int(c)
+
+    if c.is_Rational:
+        from fractions import Fraction
+
+        return Fraction(int(c.p), int(c.q))
+
+    if c.is_number:
+        c = c.evalf()
+
+    if c.is_Float:
+        import mpmath
+
+        with mpmath.workprec(c._prec):
+            return mpmath.mpf(c)
+
+    raise TypeError(
+        "cannot convert the sympy coefficient '{}' into a number".format(c))
+
+
+def from_sympy(expr, t):
+    import sympy
+    from .core import _from_terms
+
+    if not isinstance(t, type):
+        raise TypeError(
+            "the input parameter 't' is a {}, but it must be a type instead".format(type(t)))
+
+    if not isinstance(expr, sympy.Poly):
+        # NOTE: sympy's polynomials cannot represent negative
+        # exponents, thus the terms of the expanded expression
+        # are decomposed manually in order to support
+        # Laurent monomials.
+        expr = sympy.expand(sympy.sympify(expr))
+        gens = sorted(expr.free_symbols, key=str)
+
+        terms = {}
+        for term in sympy.Add.make_args(expr):
+            c, m = term.as_independent(*gens, as_Add=False)
+            pd = m.as_powers_dict()
+
+            for b, e in pd.items():
+                if b != 1 and (not b.is_Symbol or not e.is_Integer):
+                    raise ValueError(
+                        "cannot convert a sympy expression containing the non-monomial factor '{}'".format(b**e))
+
+            key = tuple(int(pd.get(g, 0)) for g in gens)
+            terms[key] = terms.get(key, 0) + c
+
+        terms = [(k, c) for k, c in terms.items() if c != 0]
+        if len(terms) == 0:
+            return t()
+
+        return _from_terms(t(), [str(g) for g in gens], [k for k, _ in terms], [_sympy_cf_to_py(sympy.sympify(c)) for _, c in terms])
+
+    poly = expr
+
+    for g in poly.gens:
+        if not g.is_Symbol:
+            raise ValueError(
+                "cannot convert a sympy polynomial whose generators are not symbols (the generator '{}' was encountered)".format(g))
+
+    terms = poly.terms()
+
+    return _from_terms(t(), [str(g) for g in poly.gens], [m for m, _ in terms], [_sympy_cf_to_py(c) for _, c in terms])
+
+
+def to_dense(p, max_degrees=None):
+    from .core import _to_dense
+
+    if max_degrees is not None:
+        max_degrees = list(max_degrees)
+
+    return _to_dense(p, max_degrees)
+
+
+def from_dense(arr, ss, t):
+    from .core import _from_dense
+
+    if not isinstance(t, type):
+        raise TypeError(
+            "the input parameter 't' is a {}, but it must be a type instead".format(type(t)))
+
+    return _from_dense(t(), list(ss), arr)
+
+
+def PowerCache(p, max_degree=None):
+    from .core import _power_cache
+
+    return _power_cache(p, max_degree)
+
+
+# NOTE: snake_case alias.
+power_cache = PowerCache
+
+
+def PolyMatrix(rows):
+    from .core import _poly_matrix
+
+    rows = [list(r) for r in rows]
+
+    if len(rows) == 0 or len(rows[0]) == 0:
+        raise ValueError("cannot create an empty polynomial matrix")
+
+    return _poly_matrix(rows[0][0], rows)
+
+
+# NOTE: snake_case alias.
+poly_matrix = PolyMatrix
+
+
+class allocator(object):
+    # Context manager to select temporarily
+    # the allocation strategy.
+    def __init__(self, name):
+        self._name = name
+
+    def __enter__(self):
+        from .core import get_allocator, set_allocator
+
+        self._old_name = get_allocator()
+        set_allocator(self._name)
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        from .core import set_allocator
+
+        set_allocator(self._old_name)
+
+
+def _setup_allocator():
+    # Select the allocation strategy at import
+    # time via the OBAKE_PY_ALLOCATOR environment
+    # variable.
+    import os
+    from .core import set_allocator
+
+    name = os.environ.get('OBAKE_PY_ALLOCATOR')
+    if name is not None:
+        set_allocator(name)
+
+
+_setup_allocator()
+
+
+class memory_budget(object):
+    # Context manager to set temporarily
+    # the memory budget.
+    def __init__(self, n):
+        self._n = n
+
+    def __enter__(self):
+        from .core import get_memory_budget, set_memory_budget
+
+        self._old_n = get_memory_budget()
+        set_memory_budget(self._n)
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        from .core import set_memory_budget
+
+        set_memory_budget(self._old_n)
+
+
+class progress(object):
+    # Context manager to set temporarily
+    # the progress callback.
+    def __init__(self, callback, interval=0.5):
+        self._callback = callback
+        self._interval = interval
+
+    def __enter__(self):
+        from .core import get_progress_callback, set_progress_callback
+
+        self._old = get_progress_callback()
+        set_progress_callback(self._callback, self._interval)
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        from .core import set_progress_callback
+
+        set_progress_callback(*self._old)
+
+
+def _register_async_atexit():
+    import atexit
+
+    atexit.register(_async_wait_pending)
+
+
+_register_async_atexit()
@@ -0,0 +1,171 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_ADDMUL_HPP
+#define OBAKE_PY_ADDMUL_HPP
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <obake/key/key_degree.hpp>
+#include <obake/polynomials/monomial_mul.hpp>
+#include <obake/polynomials/monomial_range_overflow_check.hpp>
+#include <obake/polynomials/polynomial.hpp>
+
+#include "estimate.hpp"
+#include "memory_budget.hpp"
+#include "sym_merge.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace detail
+{
+
+// Flatten the terms of x into a vector of (key, cf) pointers
+// sorted by degree. The degrees are returned as well.
+template <typename T>
+inline auto addmul_flatten(const T &x)
+{
+    using deg_t = series_degree_t<T>;
+
+    ::std::vector<::std::pair<const typename T::key_type *, const typename T::cf_type *>> terms;
+    ::std::vector<deg_t> degs;
+    terms.reserve(x.size());
+    degs.reserve(x.size());
+
+    for (const auto &t : x) {
+        terms.emplace_back(&t.first, &t.second);
+    }
+
+    ::std::vector<::std::pair<deg_t, decltype(terms.size())>> idx;
+    idx.reserve(terms.size());
+    const auto &ss = x.get_symbol_set();
+    for (decltype(terms.size()) i = 0; i < terms.size(); ++i) {
+        idx.emplace_back(deg_t(::obake::key_degree(*terms[i].first, ss)), i);
+    }
+    ::std::sort(idx.begin(), idx.end(), [](const auto &p1, const auto &p2) { return p1.first < p2.first; });
+
+    decltype(terms) s_terms;
+    s_terms.reserve(terms.size());
+    for (const auto &p : idx) {
+        s_terms.push_back(terms[p.second]);
+        degs.push_back(p.first);
+    }
+
+    return ::std::make_pair(::std::move(s_terms), ::std::move(degs));
+}
+
+} // namespace detail
+
+// Number of term pairs above which the fused multiply-accumulate
+// falls back to the (parallel) multiplication of obake.
+inline constexpr double addmul_mt_threshold = 1 << 16;
+
+// Fused multiply-accumulate: acc += a * b (if Sign is true) or acc -= a * b
+// (if Sign is false). The terms of the product are inserted directly
+// into acc, without building the product as a temporary series. If
+// max_degree is provided, the terms of the product whose degree is greater
+// than max_degree are discarded.
+// NOTE: the insertion into acc is serial, thus for large operands the
+// product is computed via the parallel multiplication of obake, and
+// then accumulated into acc.
+template <bool Sign, typename T>
+inline void series_addmul(T &acc, const T &a, const T &b, const ::std::optional<series_degree_t<T>> &max_degree)
+{
+    // Bring the three operands to a common symbol set.
+    // NOTE: a and b are copied only if needed (including
+    // the case in which they are aliases of acc).
+    const auto ss = sym_union(acc.get_symbol_set(), sym_union(a.get_symbol_set(), b.get_symbol_set()));
+
+    ::std::optional<T> a_ext, b_ext;
+    if (&a == &acc || a.get_symbol_set() != ss) {
+        a_ext.emplace(a);
+        sym_extend(*a_ext, ss);
+    }
+    if (&b == &acc || b.get_symbol_set() != ss) {
+        b_ext.emplace(b);
+        sym_extend(*b_ext, ss);
+    }
+    const auto &a_ref = a_ext ? *a_ext : a;
+    const auto &b_ref = b_ext ? *b_ext : b;
+
+    sym_extend(acc, ss);
+
+    if (a_ref.empty() || b_ref.empty()) {
+        return;
+    }
+
+    memory_budget_check([&a_ref, &b_ref, &max_degree]() { return estimate_product(a_ref, b_ref, max_degree); },
+                        "addmul");
+
+    if (static_cast<double>(a_ref.size()) * static_cast<double>(b_ref.size()) >= addmul_mt_threshold) {
+        const auto prod = max_degree ? ::obake::truncated_mul(a_ref, b_ref, *max_degree) : a_ref * b_ref;
+
+        if constexpr (Sign) {
+            acc += prod;
+        } else {
+            acc -= prod;
+        }
+
+        return;
+    }
+
+    const auto [a_terms, a_degs] = detail::addmul_flatten(a_ref);
+    const auto [b_terms, b_degs] = detail::addmul_flatten(b_ref);
+
+    // Check that the exponents of the product are representable.
+    {
+        ::std::vector<typename T::key_type> a_keys, b_keys;
+        a_keys.reserve(a_terms.size());
+        b_keys.reserve(b_terms.size());
+        for (const auto &t : a_terms) {
+            a_keys.push_back(*t.first);
+        }
+        for (const auto &t : b_terms) {
+            b_keys.push_back(*t.first);
+        }
+
+        if (!::obake::monomial_range_overflow_check(a_keys, b_keys, ss)) {
+            throw ::std::overflow_error(
+                "an overflow in the monomial exponents was detected in a fused multiply-accumulate operation");
+        }
+    }
+
+    typename T::key_type tmp_key(ss);
+
+    for (decltype(a_terms.size()) i = 0; i < a_terms.size(); ++i) {
+        if (max_degree && *max_degree < a_degs[i] + b_degs[0]) {
+            // NOTE: the terms of a are sorted by degree as well.
+            break;
+        }
+
+        const auto &[ak, ac] = a_terms[i];
+
+        for (decltype(b_terms.size()) j = 0; j < b_terms.size(); ++j) {
+            if (max_degree && *max_degree < a_degs[i] + b_degs[j]) {
+                // NOTE: the terms of b are sorted by degree,
+                // the remaining ones would be discarded too.
+                break;
+            }
+
+            const auto &[bk, bc] = b_terms[j];
+
+            ::obake::monomial_mul(tmp_key, *ak, *bk, ss);
+            acc.template add_term<Sign>(tmp_key, *ac * *bc);
+        }
+    }
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,359 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gmp.h>
+
+#include <pybind11/pybind11.h>
+
+#include "allocator.hpp"
+#include "utils.hpp"
+
+// NOTE: the limbs of mp++'s multiprecision types (and of the
+// MPFR-based real type) are allocated through GMP's memory functions.
+// The pooled allocator replaces those functions with versions which
+// recycle small blocks via per-thread free lists, avoiding
+// contention on the global malloc lock.
+//
+// Every block handed out by the pooled allocator is a genuine block
+// from the original GMP allocation functions, whose size is at least
+// the requested size. A freed block of size n is recycled only for
+// requests not larger than the largest size class not exceeding n.
+// Thus blocks allocated before the installation of the hooks (or while
+// the pool is disabled) can be safely recycled, and the pool can be
+// switched on and off at any time.
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+namespace detail
+{
+
+namespace
+{
+
+// The original GMP memory functions.
+void *(*orig_alloc)(::std::size_t) = nullptr;
+void *(*orig_realloc)(void *, ::std::size_t, ::std::size_t) = nullptr;
+void (*orig_free)(void *, ::std::size_t) = nullptr;
+
+::std::once_flag alloc_install_flag;
+
+// Pool switch.
+::std::atomic<bool> alloc_pooled(false);
+
+// Size classes: powers of two from 16
+// to 4096 bytes.
+constexpr unsigned alloc_n_classes = 9;
+constexpr ::std::size_t alloc_min_class_size = 16;
+constexpr ::std::size_t alloc_max_class_size = alloc_min_class_size << (alloc_n_classes - 1u);
+
+// Max number of blocks in a free list.
+constexpr ::std::size_t alloc_max_cached_blocks = 256;
+
+::std::size_t alloc_class_size(unsigned c)
+{
+    return alloc_min_class_size << c;
+}
+
+// Index of the smallest size class which can
+// hold n bytes. Requires n <= alloc_max_class_size.
+unsigned alloc_ceil_class(::std::size_t n)
+{
+    unsigned c = 0;
+    while (alloc_class_size(c) < n) {
+        ++c;
+    }
+    return c;
+}
+
+// Index of the largest size class whose size is not greater than n.
+// Requires alloc_min_class_size <= n <= alloc_max_class_size.
+unsigned alloc_floor_class(::std::size_t n)
+{
+    unsigned c = 0;
+    while (c + 1u < alloc_n_classes && alloc_class_size(c + 1u) <= n) {
+        ++c;
+    }
+    return c;
+}
+
+// The per-thread free lists.
+struct alloc_thread_pool {
+    ~alloc_thread_pool();
+
+    ::std::array<::std::vector<void *>, alloc_n_classes> m_lists;
+};
+
+// NOTE: GMP memory may be freed by other thread-local objects
+// after the destruction of the thread pool (e.g., mp++'s caches).
+// This flag, which is trivially destructible, signals that the
+// pool must not be used any more in the current thread.
+thread_local bool alloc_tl_pool_dead = false;
+thread_local alloc_thread_pool alloc_tl_pool;
+
+alloc_thread_pool::~alloc_thread_pool()
+{
+    alloc_tl_pool_dead = true;
+
+    for (unsigned c = 0; c < alloc_n_classes; ++c) {
+        for (auto *ptr : m_lists[c]) {
+            orig_free(ptr, alloc_class_size(c));
+        }
+    }
+}
+
+// Counters.
+// NOTE: the counters are kept per thread in order to avoid contention
+// on shared cache lines, and they are aggregated when the stats are read.
+// Each set of counters is written only by its owner thread, hence the
+// updates are plain relaxed loads and stores rather than atomic RMWs.
+struct alignas(64) alloc_counters {
+    ::std::atomic<unsigned long long> m_n_allocs = 0, m_n_reallocs = 0, m_n_frees = 0, m_n_pool_hits = 0;
+    // The net number of bytes not yet flushed
+    // into the global byte counter.
+    ::std::atomic<long long> m_bytes = 0;
+};
+
+// The registry of all the counters ever created, and the counters
+// released by the threads which have exited (which are recycled for
+// new threads). The counters are never destroyed, as they might
+// be accessed after the end of the program.
+::std::mutex alloc_counters_mutex;
+auto &alloc_counters_registry = *new ::std::vector<alloc_counters *>;
+auto &alloc_counters_free = *new ::std::vector<alloc_counters *>;
+
+// Counters for the allocations performed by a thread after
+// the release of its own counters (see alloc_tl_counters_dead below).
+// These are shared, hence they are updated with atomic RMWs.
+alloc_counters alloc_orphan_counters;
+
+// The global byte counter and its peak value. The per-thread
+// net byte counts are flushed into the global counter when their
+// magnitude exceeds a threshold, hence the peak value is approximate
+// (it may miss up to the threshold times the number of threads).
+constexpr long long alloc_flush_threshold = 1ll << 16;
+::std::atomic<long long> alloc_flushed_bytes(0), alloc_peak_bytes(0);
+
+// Baseline of the counters, set by reset_allocator_stats().
+struct alloc_totals {
+    unsigned long long m_n_allocs = 0, m_n_reallocs = 0, m_n_frees = 0, m_n_pool_hits = 0;
+    long long m_bytes = 0;
+};
+alloc_totals alloc_baseline;
+
+struct alloc_thread_counters {
+    alloc_thread_counters();
+    ~alloc_thread_counters();
+
+    alloc_counters *m_ptr;
+};
+
+// NOTE: as with the thread pool, GMP memory may be
+// (de)allocated after the destruction of the counters.
+thread_local bool alloc_tl_counters_dead = false;
+thread_local alloc_thread_counters alloc_tl_counters;
+
+alloc_thread_counters::alloc_thread_counters()
+{
+    ::std::lock_guard lock(alloc_counters_mutex);
+
+    if (alloc_counters_free.empty()) {
+        m_ptr = new alloc_counters;
+        alloc_counters_registry.push_back(m_ptr);
+    } else {
+        m_ptr = alloc_counters_free.back();
+        alloc_counters_free.pop_back();
+    }
+}
+
+alloc_thread_counters::~alloc_thread_counters()
+{
+    alloc_tl_counters_dead = true;
+
+    ::std::lock_guard lock(alloc_counters_mutex);
+    alloc_counters_free.push_back(m_ptr);
+}
+
+void alloc_update_peak(long long cur)
+{
+    auto peak = alloc_peak_bytes.load(::std::memory_order_relaxed);
+    while (cur > peak && !alloc_peak_bytes.compare_exchange_weak(peak, cur, ::std::memory_order_relaxed)) {
+    }
+}
+
+// Increase by one the counter member m and by n the
+// number of bytes in the counters of the current thread.
+void alloc_count(::std::atomic<unsigned long long> alloc_counters::*m, long long n)
+{
+    if (alloc_tl_counters_dead) {
+        (alloc_orphan_counters.*m).fetch_add(1u, ::std::memory_order_relaxed);
+        alloc_update_peak(alloc_flushed_bytes.fetch_add(n, ::std::memory_order_relaxed) + n);
+        return;
+    }
+
+    auto &c = *alloc_tl_counters.m_ptr;
+
+    (c.*m).store((c.*m).load(::std::memory_order_relaxed) + 1u, ::std::memory_order_relaxed);
+
+    const auto bytes = c.m_bytes.load(::std::memory_order_relaxed) + n;
+    if (bytes >= alloc_flush_threshold || bytes <= -alloc_flush_threshold) {
+        c.m_bytes.store(0, ::std::memory_order_relaxed);
+        alloc_update_peak(alloc_flushed_bytes.fetch_add(bytes, ::std::memory_order_relaxed) + bytes);
+    } else {
+        c.m_bytes.store(bytes, ::std::memory_order_relaxed);
+    }
+}
+
+// Aggregate the counters.
+// NOTE: this must be called with alloc_counters_mutex locked.
+alloc_totals alloc_aggregate()
+{
+    alloc_totals retval;
+
+    auto add = [&retval](const alloc_counters &c) {
+        retval.m_n_allocs += c.m_n_allocs.load(::std::memory_order_relaxed);
+        retval.m_n_reallocs += c.m_n_reallocs.load(::std::memory_order_relaxed);
+        retval.m_n_frees += c.m_n_frees.load(::std::memory_order_relaxed);
+        retval.m_n_pool_hits += c.m_n_pool_hits.load(::std::memory_order_relaxed);
+        retval.m_bytes += c.m_bytes.load(::std::memory_order_relaxed);
+    };
+
+    for (const auto *ptr : alloc_counters_registry) {
+        add(*ptr);
+    }
+    add(alloc_orphan_counters);
+    retval.m_bytes += alloc_flushed_bytes.load(::std::memory_order_relaxed);
+
+    return retval;
+}
+
+void *pool_alloc(::std::size_t n)
+{
+    alloc_count(&alloc_counters::m_n_allocs, static_cast<long long>(n));
+
+    if (alloc_pooled.load(::std::memory_order_relaxed) && n <= alloc_max_class_size && !alloc_tl_pool_dead) {
+        const auto c = alloc_ceil_class(n);
+        auto &l = alloc_tl_pool.m_lists[c];
+
+        if (!l.empty()) {
+            auto *retval = l.back();
+            l.pop_back();
+            alloc_count(&alloc_counters::m_n_pool_hits, 0);
+            return retval;
+        }
+
+        return orig_alloc(alloc_class_size(c));
+    }
+
+    return orig_alloc(n);
+}
+
+void *pool_realloc(void *ptr, ::std::size_t old_n, ::std::size_t new_n)
+{
+    alloc_count(&alloc_counters::m_n_reallocs, static_cast<long long>(new_n) - static_cast<long long>(old_n));
+
+    return orig_realloc(ptr, old_n, new_n);
+}
+
+void pool_free(void *ptr, ::std::size_t n)
+{
+    alloc_count(&alloc_counters::m_n_frees, -static_cast<long long>(n));
+
+    if (alloc_pooled.load(::std::memory_order_relaxed) && n >= alloc_min_class_size && n <= alloc_max_class_size
+        && !alloc_tl_pool_dead) {
+        auto &l = alloc_tl_pool.m_lists[alloc_floor_class(n)];
+
+        if (l.size() < alloc_max_cached_blocks) {
+            l.push_back(ptr);
+            return;
+        }
+    }
+
+    orig_free(ptr, n);
+}
+
+// Install the hooks into GMP.
+// NOTE: this should be done while no other thread is using GMP.
+void alloc_install_hooks()
+{
+    ::std::call_once(alloc_install_flag, []() {
+        ::mp_get_memory_functions(&orig_alloc, &orig_realloc, &orig_free);
+        ::mp_set_memory_functions(pool_alloc, pool_realloc, pool_free);
+    });
+}
+
+} // namespace
+
+} // namespace detail
+
+// NOTE: the hooks are installed also when selecting
+// the system allocator, so that the counters are
+// available for comparison.
+void set_allocator(const ::std::string &name)
+{
+    if (name != "system" && name != "pooled") {
+        py_throw(::PyExc_ValueError,
+                 ("the allocator must be either 'system' or 'pooled', but '" + name + "' was specified instead")
+                     .c_str());
+    }
+
+    detail::alloc_install_hooks();
+    detail::alloc_pooled.store(name == "pooled", ::std::memory_order_relaxed);
+}
+
+::std::string get_allocator()
+{
+    return detail::alloc_pooled.load(::std::memory_order_relaxed) ? "pooled" : "system";
+}
+
+py::dict allocator_stats()
+{
+    detail::alloc_totals tot;
+    long long peak;
+    {
+        ::std::lock_guard lock(detail::alloc_counters_mutex);
+        tot = detail::alloc_aggregate();
+        peak = ::std::max(detail::alloc_peak_bytes.load(::std::memory_order_relaxed), tot.m_bytes);
+    }
+
+    const auto &base = detail::alloc_baseline;
+
+    py::dict retval;
+
+    retval["allocations"] = tot.m_n_allocs - base.m_n_allocs;
+    retval["reallocations"] = tot.m_n_reallocs - base.m_n_reallocs;
+    retval["deallocations"] = tot.m_n_frees - base.m_n_frees;
+    retval["pool_hits"] = tot.m_n_pool_hits - base.m_n_pool_hits;
+    retval["bytes"] = tot.m_bytes - base.m_bytes;
+    retval["peak"] = peak - base.m_bytes;
+
+    return retval;
+}
+
+// NOTE: the per-thread counters are written only by their
+// owner threads, thus the reset just records the current totals
+// as the baseline for the values returned by allocator_stats().
+void reset_allocator_stats()
+{
+    ::std::lock_guard lock(detail::alloc_counters_mutex);
+
+    detail::alloc_baseline = detail::alloc_aggregate();
+    detail::alloc_peak_bytes.store(detail::alloc_baseline.m_bytes, ::std::memory_order_relaxed);
+}
+
+} // namespace obake_py
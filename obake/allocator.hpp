@@ -0,0 +1,32 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_ALLOCATOR_HPP
+#define OBAKE_PY_ALLOCATOR_HPP
+
+#include <string>
+
+#include <pybind11/pybind11.h>
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+// Set/get the allocation strategy for the limbs
+// of the multiprecision coefficients ("system" or "pooled").
+void set_allocator(const ::std::string &);
+::std::string get_allocator();
+
+// Fetch/reset the allocation counters.
+py::dict allocator_stats();
+void reset_allocator_stats();
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,88 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <exception>
+#include <new>
+#include <stdexcept>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/task_arena.h>
+
+#include "async.hpp"
+#include "memory_budget.hpp"
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+::tbb::task_arena &async_arena()
+{
+    static ::tbb::task_arena arena;
+
+    return arena;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to set into the future fut an exception
+// of type type with error message msg.
+void async_set_exception_impl(const py::object &fut, ::PyObject *type, const char *msg)
+{
+    fut.attr("set_exception")(py::handle(type)(msg));
+}
+
+} // namespace
+
+} // namespace detail
+
+// NOTE: the mapping between C++ and Python exceptions
+// mirrors pybind11's default exception translation
+// (plus the translations of std::overflow_error and
+// memory_budget_error registered in the core module).
+void async_set_exception(const py::object &fut, ::std::exception_ptr eptr)
+{
+    try {
+        ::std::rethrow_exception(eptr);
+    } catch (py::error_already_set &e) {
+        fut.attr("set_exception")(e.value());
+    } catch (const ::std::overflow_error &e) {
+        detail::async_set_exception_impl(fut, ::PyExc_OverflowError, e.what());
+    } catch (const memory_budget_error &e) {
+        detail::async_set_exception_impl(fut, ::PyExc_MemoryError, e.what());
+    } catch (const ::std::bad_alloc &) {
+        detail::async_set_exception_impl(fut, ::PyExc_MemoryError, "std::bad_alloc");
+    } catch (const ::std::out_of_range &e) {
+        detail::async_set_exception_impl(fut, ::PyExc_IndexError, e.what());
+    } catch (const ::std::invalid_argument &e) {
+        detail::async_set_exception_impl(fut, ::PyExc_ValueError, e.what());
+    } catch (const ::std::domain_error &e) {
+        detail::async_set_exception_impl(fut, ::PyExc_ValueError, e.what());
+    } catch (const ::std::length_error &e) {
+        detail::async_set_exception_impl(fut, ::PyExc_ValueError, e.what());
+    } catch (const ::std::range_error &e) {
+        detail::async_set_exception_impl(fut, ::PyExc_ValueError, e.what());
+    } catch (const ::std::exception &e) {
+        detail::async_set_exception_impl(fut, ::PyExc_RuntimeError, e.what());
+    } catch (...) {
+        detail::async_set_exception_impl(fut, ::PyExc_RuntimeError, "unknown exception");
+    }
+}
+
+void async_report_error(py::error_already_set &e, const py::object &fut)
+{
+    e.restore();
+    ::PyErr_WriteUnraisable(fut.ptr());
+}
+
+} // namespace obake_py
@@ -0,0 +1,93 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_ASYNC_HPP
+#define OBAKE_PY_ASYNC_HPP
+
+#include <exception>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/task_arena.h>
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+// The TBB arena into which the asynchronous
+// computations are enqueued.
+::tbb::task_arena &async_arena();
+
+// Set the exception stored in the input exception
+// pointer into the Python future fut.
+// NOTE: this must be called with the GIL held.
+void async_set_exception(const py::object &, ::std::exception_ptr);
+
+// Report an error raised while setting the
+// outcome of an asynchronous computation.
+// NOTE: this must be called with the GIL held.
+void async_report_error(py::error_already_set &, const py::object &);
+
+// Enqueue the asynchronous computation f() into the async
+// arena. The outcome of the computation will be
+// set into the Python future fut, which must be
+// in the running state. f() must not interact
+// with Python, and it must own its inputs (i.e., it must
+// capture copies of the Python objects' contents), as the
+// objects may be modified or destroyed while it is running.
+template <typename F>
+inline void async_submit(const py::object &fut, F f)
+{
+    // NOTE: the task keeps a reference to the future,
+    // which is released with the GIL held. The reference
+    // is owned by the task only after a successful enqueue.
+    ::std::unique_ptr<py::object> fut_owner(new py::object(fut));
+    const auto fut_ptr = fut_owner.get();
+
+    async_arena().enqueue([f = ::std::move(f), fut_ptr]() {
+        ::std::optional<decltype(f())> res;
+        ::std::exception_ptr eptr;
+
+        try {
+            res.emplace(f());
+        } catch (...) {
+            eptr = ::std::current_exception();
+        }
+
+        py::gil_scoped_acquire acquire;
+
+        ::std::unique_ptr<py::object> fut_holder(fut_ptr);
+
+        try {
+            if (eptr) {
+                async_set_exception(*fut_holder, eptr);
+            } else {
+                fut_holder->attr("set_result")(::std::move(*res));
+            }
+        } catch (py::error_already_set &e) {
+            // NOTE: there's no caller to propagate
+            // the error to at this point.
+            async_report_error(e, *fut_holder);
+        }
+
+        // NOTE: make sure the result and the exception
+        // are destroyed with the GIL held.
+        res.reset();
+        eptr = nullptr;
+    });
+
+    fut_owner.release();
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,466 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_CONVERTERS_HPP
+#define OBAKE_PY_CONVERTERS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/hana/for_each.hpp>
+
+#include <mp++/integer.hpp>
+
+#include <obake/symbols.hpp>
+#include <obake/type_name.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "key_utils.hpp"
+#include "metadata.hpp"
+#include "series_table.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace hana = ::boost::hana;
+namespace py = ::pybind11;
+
+namespace detail
+{
+
+// Convert the Python object o into a coefficient of type C. The
+// conversion to C is attempted first. If it fails, the conversions to
+// the interoperable types are attempted, followed by a conversion
+// to C. For integral coefficients, only exact conversions are accepted.
+template <typename C, typename Types>
+inline C converters_py_to_cf(const py::handle &o, const Types &interop_types)
+{
+    try {
+        return o.template cast<C>();
+    } catch (const py::cast_error &) {
+    }
+
+    ::std::optional<C> retval;
+    hana::for_each(interop_types, [&o, &retval](auto t) {
+        using cur_t = typename decltype(t)::type;
+
+        if constexpr (!::std::is_same_v<cur_t, C> && ::std::is_constructible_v<C, const cur_t &>) {
+            if (retval) {
+                return;
+            }
+
+            try {
+                const auto v = o.template cast<cur_t>();
+                C c(v);
+                if constexpr (::std::is_same_v<C, ::mppp::integer<1>>) {
+                    if (!(cur_t(c) == v)) {
+                        return;
+                    }
+                }
+                retval.emplace(::std::move(c));
+            } catch (const py::cast_error &) {
+            }
+        }
+    });
+
+    if (!retval) {
+        py_throw(::PyExc_TypeError, ("cannot convert an object of type '"
+                                     + py::str(o.get_type()).template cast<::std::string>()
+                                     + "' into a coefficient of type '" + ::obake::type_name<C>() + "'")
+                                        .c_str());
+    }
+
+    return ::std::move(*retval);
+}
+
+// Convert the list of symbol names syms (in arbitrary order) into a symbol
+// set. The positions of the symbols in the symbol set are written into perm.
+inline ::obake::symbol_set converters_symbols(const py::list &syms, ::std::vector<::std::size_t> &perm)
+{
+    const auto ss = py_object_to_obake_ss(syms);
+    if (ss.size() != py::len(syms)) {
+        py_throw(::PyExc_ValueError, "the list of symbols passed to a polynomial converter contains duplicates");
+    }
+
+    perm.clear();
+    for (const auto &s : syms) {
+        perm.push_back(static_cast<::std::size_t>(ss.index_of(ss.find(s.cast<::std::string>()))));
+    }
+
+    return ss;
+}
+
+// Row-major strides for the dense shape.
+inline ::std::vector<::std::size_t> converters_strides(const ::std::vector<::std::size_t> &shape)
+{
+    ::std::vector<::std::size_t> retval(shape.size());
+
+    ::std::size_t size = 1;
+    for (auto i = shape.size(); i > 0u; --i) {
+        retval[i - 1u] = size;
+        if (shape[i - 1u] != 0u && size > ::std::numeric_limits<::std::size_t>::max() / shape[i - 1u]) {
+            py_throw(::PyExc_ValueError, "the size of the dense representation of a polynomial is too large");
+        }
+        size *= shape[i - 1u];
+    }
+
+    return retval;
+}
+
+} // namespace detail
+
+// Expose the conversion functions for the series type T.
+template <typename T, typename Types>
+inline void expose_converters(py::module &m, const Types &interop_types)
+{
+    using cf_t = typename T::cf_type;
+    using key_t = typename T::key_type;
+    using exp_t = typename series_metadata<T>::exp_t;
+
+    // Term lists. The exponents are ordered as the symbol set.
+    m.def("_to_terms", [](const T &x) {
+        const auto &ss = x.get_symbol_set();
+
+        py::list exps, cfs;
+        ::std::vector<exp_t> tmp;
+        for (const auto &t : x) {
+            key_unpack(t.first, ss, tmp);
+
+            py::tuple e(tmp.size());
+            for (decltype(tmp.size()) i = 0; i < tmp.size(); ++i) {
+                e[i] = py::cast(tmp[i]);
+            }
+
+            exps.append(::std::move(e));
+            cfs.append(py::cast(t.second));
+        }
+
+        return py::make_tuple(obake_ss_to_py_list(ss), ::std::move(exps), ::std::move(cfs));
+    });
+    m.def("_from_terms", [interop_types](const T &, const py::list &syms, const py::list &exps, const py::list &cfs) {
+        if (py::len(exps) != py::len(cfs)) {
+            py_throw(::PyExc_ValueError, ("the number of exponent tuples (" + ::std::to_string(py::len(exps))
+                                          + ") differs from the number of coefficients ("
+                                          + ::std::to_string(py::len(cfs)) + ")")
+                                             .c_str());
+        }
+
+        ::std::vector<::std::size_t> perm;
+        const auto ss = detail::converters_symbols(syms, perm);
+
+        ::std::vector<key_t> keys;
+        ::std::vector<cf_t> c_vec;
+        keys.reserve(py::len(exps));
+        c_vec.reserve(py::len(cfs));
+
+        ::std::vector<exp_t> tmp(ss.size());
+        for (::std::size_t i = 0; i < py::len(exps); ++i) {
+            const auto e = exps[i].template cast<py::sequence>();
+            if (py::len(e) != perm.size()) {
+                py_throw(::PyExc_ValueError, ("an exponent tuple of size " + ::std::to_string(py::len(e))
+                                              + " was encountered, but the number of symbols is "
+                                              + ::std::to_string(perm.size()))
+                                                 .c_str());
+            }
+
+            for (decltype(perm.size()) j = 0; j < perm.size(); ++j) {
+                tmp[perm[j]] = e[j].template cast<exp_t>();
+            }
+
+            keys.push_back(key_pack<key_t>(tmp));
+            c_vec.push_back(detail::converters_py_to_cf<cf_t>(py::object(cfs[i]), interop_types));
+        }
+
+        py::gil_scoped_release release;
+
+        T retval;
+        retval.set_symbol_set(ss);
+        series_reserve(retval, static_cast<unsigned long long>(keys.size()));
+        for (decltype(keys.size()) i = 0; i < keys.size(); ++i) {
+            retval.add_term(::std::move(keys[i]), ::std::move(c_vec[i]));
+        }
+
+        return retval;
+    });
+
+    // Dense arrays. The axes of the array returned by _to_dense()
+    // are ordered as the symbol set, and their sizes are the maximum
+    // exponents (either given or computed) plus one.
+    m.def("_to_dense", [](const T &x, const py::object &max_degrees) {
+        const auto &ss = x.get_symbol_set();
+
+        ::std::vector<::std::size_t> shape(ss.size());
+        if (max_degrees.is_none()) {
+            // NOTE: the cached metadata is not used here, as the
+            // shape of the array must match the actual exponents.
+            series_metadata<T> md;
+            {
+                py::gil_scoped_release release;
+
+                md = series_metadata_compute(x);
+            }
+
+            for (decltype(shape.size()) i = 0; i < shape.size(); ++i) {
+                if (md.m_min_exps[i] < 0) {
+                    py_throw(::PyExc_ValueError,
+                             "cannot convert a polynomial with negative exponents into a dense array");
+                }
+                shape[i] = static_cast<::std::size_t>(md.m_max_exps[i]) + 1u;
+            }
+        } else {
+            const auto l = max_degrees.cast<py::list>();
+            if (py::len(l) != shape.size()) {
+                py_throw(::PyExc_ValueError, ("the number of maximum degrees (" + ::std::to_string(py::len(l))
+                                              + ") differs from the number of symbols of the polynomial ("
+                                              + ::std::to_string(shape.size()) + ")")
+                                                 .c_str());
+            }
+
+            for (decltype(shape.size()) i = 0; i < shape.size(); ++i) {
+                const auto d = l[i].template cast<long long>();
+                if (d < 0) {
+                    py_throw(::PyExc_ValueError,
+                             ("the maximum degrees must be non-negative, but a value of " + ::std::to_string(d)
+                              + " was specified instead")
+                                 .c_str());
+                }
+                shape[i] = static_cast<::std::size_t>(d) + 1u;
+            }
+        }
+
+        const auto strides = detail::converters_strides(shape);
+
+        py::tuple py_shape(shape.size());
+        for (decltype(shape.size()) i = 0; i < shape.size(); ++i) {
+            py_shape[i] = py::cast(shape[i]);
+        }
+
+        const auto np = py::module::import("numpy");
+        const auto &s_table = x._get_s_table();
+
+        // Compute the position of the term t in the dense
+        // array, returning false if it is out of bounds.
+        const auto term_idx = [&ss, &shape, &strides](const auto &t, ::std::vector<exp_t> &tmp, ::std::size_t &idx) {
+            key_unpack(t.first, ss, tmp);
+
+            idx = 0;
+            for (decltype(tmp.size()) i = 0; i < tmp.size(); ++i) {
+                if (tmp[i] < 0 || static_cast<unsigned long long>(tmp[i]) >= shape[i]) {
+                    return false;
+                }
+                idx += static_cast<::std::size_t>(tmp[i]) * strides[i];
+            }
+
+            return true;
+        };
+
+        ::std::atomic<bool> oob = false;
+
+        py::object retval;
+        if constexpr (::std::is_same_v<cf_t, double>) {
+            // Fill the array in parallel.
+            retval = np.attr("zeros")(py_shape, py::arg("dtype") = "float64");
+
+            const auto info = retval.template cast<py::buffer>().request(true);
+            auto ptr = static_cast<double *>(info.ptr);
+
+            py::gil_scoped_release release;
+
+            ::tbb::parallel_for(::tbb::blocked_range<decltype(s_table.size())>(0, s_table.size()),
+                                [&s_table, &term_idx, &oob, ptr](const auto &r) {
+                                    ::std::vector<exp_t> tmp;
+                                    ::std::size_t idx;
+
+                                    for (auto i = r.begin(); i != r.end(); ++i) {
+                                        for (const auto &t : s_table[i]) {
+                                            if (term_idx(t, tmp, idx)) {
+                                                ptr[idx] = t.second;
+                                            } else {
+                                                oob.store(true, ::std::memory_order_relaxed);
+                                            }
+                                        }
+                                    }
+                                });
+        } else {
+            // Compute the positions in parallel, then
+            // fill the array with the GIL held.
+            retval = np.attr("full")(py_shape, py::cast(cf_t(0)), py::arg("dtype") = "object");
+
+            ::std::vector<::std::vector<::std::pair<::std::size_t, const cf_t *>>> s_pos(s_table.size());
+            {
+                py::gil_scoped_release release;
+
+                ::tbb::parallel_for(::tbb::blocked_range<decltype(s_table.size())>(0, s_table.size()),
+                                    [&s_table, &term_idx, &oob, &s_pos](const auto &r) {
+                                        ::std::vector<exp_t> tmp;
+                                        ::std::size_t idx;
+
+                                        for (auto i = r.begin(); i != r.end(); ++i) {
+                                            for (const auto &t : s_table[i]) {
+                                                if (term_idx(t, tmp, idx)) {
+                                                    s_pos[i].emplace_back(idx, &t.second);
+                                                } else {
+                                                    oob.store(true, ::std::memory_order_relaxed);
+                                                }
+                                            }
+                                        }
+                                    });
+            }
+
+            if (!oob.load(::std::memory_order_relaxed)) {
+                auto flat = retval.attr("reshape")(-1);
+                for (const auto &v : s_pos) {
+                    for (const auto &[idx, c] : v) {
+                        flat[py::cast(idx)] = py::cast(*c);
+                    }
+                }
+            }
+        }
+
+        if (oob.load(::std::memory_order_relaxed)) {
+            py_throw(::PyExc_ValueError, "the polynomial contains a term whose exponents are out of the bounds "
+                                         "of the dense array");
+        }
+
+        return retval;
+    });
+    m.def("_from_dense", [interop_types](const T &, const py::list &syms, const py::object &arr) {
+        ::std::vector<::std::size_t> perm;
+        const auto ss = detail::converters_symbols(syms, perm);
+
+        const auto np = py::module::import("numpy");
+
+        // Convert the index idx of the dense array
+        // into a key.
+        const auto idx_key = [&perm](::std::size_t idx, const ::std::vector<::std::size_t> &shape,
+                                     ::std::vector<exp_t> &tmp) {
+            for (auto i = shape.size(); i > 0u; --i) {
+                tmp[perm[i - 1u]] = static_cast<exp_t>(idx % shape[i - 1u]);
+                idx /= shape[i - 1u];
+            }
+
+            return key_pack<key_t>(tmp);
+        };
+
+        const auto check_ndim = [&perm](::std::size_t ndim) {
+            if (ndim != perm.size()) {
+                py_throw(::PyExc_ValueError, ("the number of dimensions of the array (" + ::std::to_string(ndim)
+                                              + ") differs from the number of symbols ("
+                                              + ::std::to_string(perm.size()) + ")")
+                                                 .c_str());
+            }
+        };
+
+        ::std::vector<::std::vector<::std::pair<key_t, cf_t>>> chunks;
+
+        if constexpr (::std::is_same_v<cf_t, double>) {
+            // Scan the array in parallel.
+            const auto a = np.attr("ascontiguousarray")(arr, py::arg("dtype") = "float64");
+            const auto info = a.template cast<py::buffer>().request();
+            check_ndim(static_cast<::std::size_t>(info.ndim));
+
+            const ::std::vector<::std::size_t> shape(info.shape.begin(), info.shape.end());
+            const auto size = static_cast<::std::size_t>(info.size);
+            const auto ptr = static_cast<const double *>(info.ptr);
+
+            py::gil_scoped_release release;
+
+            // NOTE: use a fixed number of chunks, so that
+            // the order of the terms is deterministic.
+            constexpr ::std::size_t chunk_size = 1u << 16;
+            chunks.resize(size / chunk_size + 1u);
+
+            ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, chunks.size()),
+                                [&chunks, &idx_key, &shape, &perm, size, ptr](const auto &r) {
+                                    ::std::vector<exp_t> tmp(perm.size());
+
+                                    for (auto c = r.begin(); c != r.end(); ++c) {
+                                        const auto end = ::std::min(size, (c + 1u) * chunk_size);
+                                        for (auto i = c * chunk_size; i < end; ++i) {
+                                            if (ptr[i] != 0) {
+                                                chunks[c].emplace_back(idx_key(i, shape, tmp), ptr[i]);
+                                            }
+                                        }
+                                    }
+                                });
+        } else {
+            // Fetch and convert the nonzero elements with
+            // the GIL held, then compute the keys in parallel.
+            const auto a = np.attr("asarray")(arr);
+            check_ndim(a.attr("ndim").template cast<::std::size_t>());
+
+            ::std::vector<::std::size_t> shape;
+            for (const auto &n : a.attr("shape")) {
+                shape.push_back(n.template cast<::std::size_t>());
+            }
+            // NOTE: tolist() converts the NumPy scalars
+            // into Python objects.
+            const auto nz_arr = np.attr("flatnonzero")(a);
+            const auto nz = nz_arr.attr("tolist")().template cast<py::list>();
+            const auto vals = a.attr("ravel")()[nz_arr].attr("tolist")().template cast<py::list>();
+
+            ::std::vector<::std::size_t> idx_vec;
+            ::std::vector<cf_t> c_vec;
+            idx_vec.reserve(py::len(nz));
+            c_vec.reserve(py::len(nz));
+            for (::std::size_t i = 0; i < py::len(nz); ++i) {
+                idx_vec.push_back(nz[i].template cast<::std::size_t>());
+                c_vec.push_back(detail::converters_py_to_cf<cf_t>(py::object(vals[i]), interop_types));
+            }
+
+            py::gil_scoped_release release;
+
+            chunks.resize(1);
+            chunks[0].resize(idx_vec.size());
+
+            ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, idx_vec.size()),
+                                [&chunks, &idx_key, &shape, &perm, &idx_vec, &c_vec](const auto &r) {
+                                    ::std::vector<exp_t> tmp(perm.size());
+
+                                    for (auto i = r.begin(); i != r.end(); ++i) {
+                                        chunks[0][i].first = idx_key(idx_vec[i], shape, tmp);
+                                        chunks[0][i].second = ::std::move(c_vec[i]);
+                                    }
+                                });
+        }
+
+        py::gil_scoped_release release;
+
+        unsigned long long n = 0;
+        for (const auto &c : chunks) {
+            n += c.size();
+        }
+
+        T retval;
+        retval.set_symbol_set(ss);
+        series_reserve(retval, n);
+        for (auto &c : chunks) {
+            for (auto &[k, cf] : c) {
+                retval.add_term(::std::move(k), ::std::move(cf));
+            }
+        }
+
+        return retval;
+    });
+}
+
+} // namespace obake_py
+
+#endif
@@ -31,7 +31,14 @@
 
 #include <pybind11/pybind11.h>
 
+#include <tbb/task_arena.h>
+
+#include "allocator.hpp"
+#include "interrupt.hpp"
+#include "memory_budget.hpp"
 #include "polynomials.hpp"
+#include "shared_polynomial.hpp"
+#include "sym_merge.hpp"
 #include "type_system.hpp"
 
 namespace py = ::pybind11;
@@ -104,9 +111,35 @@ PYBIND11_MODULE(core, m)
             }
         } catch (const ::std::overflow_error &e) {
             ::PyErr_SetString(::PyExc_OverflowError, e.what());
+        } catch (const obpy::memory_budget_error &e) {
+            ::PyErr_SetString(::PyExc_MemoryError, e.what());
         }
     });
 
+    // Allocation strategy.
+    m.def("set_allocator", &obpy::set_allocator);
+    m.def("get_allocator", &obpy::get_allocator);
+    m.def("allocator_stats", &obpy::allocator_stats);
+    m.def("reset_allocator_stats", &obpy::reset_allocator_stats);
+
+    // Memory budget.
+    m.def("set_memory_budget", &obpy::set_memory_budget);
+    m.def("get_memory_budget", &obpy::get_memory_budget);
+
+    // Progress callback.
+    m.def("set_progress_callback", &obpy::set_progress_callback, py::arg("callback"), py::arg("interval") = 0.5);
+    m.def("get_progress_callback", &obpy::get_progress_callback);
+    // NOTE: the operations can be interrupted only
+    // if TBB has worker threads.
+    m.def("_max_concurrency", []() { return ::tbb::this_task_arena::max_concurrency(); });
+
+    // Symbol merge counters.
+    m.def("symbol_merge_stats", &obpy::sym_merge_stats);
+    m.def("reset_symbol_merge_stats", &obpy::reset_sym_merge_stats);
+
     // Expose the polynomials.
     obpy::expose_polynomials(m);
+
+    // Shared polynomials.
+    m.def("_shared_attach", &obpy::shared_attach);
 }
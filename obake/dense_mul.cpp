@@ -0,0 +1,108 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/math/constants/constants.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "dense_mul.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+mul_method str_to_mul_method(const ::std::string &s)
+{
+    if (s == "auto") {
+        return mul_method::automatic;
+    } else if (s == "sparse") {
+        return mul_method::sparse;
+    } else if (s == "dense") {
+        return mul_method::dense;
+    }
+
+    py_throw(::PyExc_ValueError,
+             ("the multiplication method must be one of 'auto', 'sparse' or 'dense', but '" + s
+              + "' was specified instead")
+                 .c_str());
+}
+
+namespace detail
+{
+
+void dense_mul_fft(::std::vector<::std::complex<double>> &v, bool inverse)
+{
+    const auto n = v.size();
+
+    if (n < 2u) {
+        return;
+    }
+
+    // Bit-reversal permutation.
+    for (::std::size_t i = 1, j = 0; i < n; ++i) {
+        auto bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if (i < j) {
+            ::std::swap(v[i], v[j]);
+        }
+    }
+
+    // The roots of unity. NOTE: they are computed directly,
+    // rather than via repeated multiplications, in order
+    // to limit the accumulation of rounding errors.
+    const auto two_pi = 2 * ::boost::math::constants::pi<double>();
+    ::std::vector<::std::complex<double>> roots(n / 2u);
+    ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, n / 2u), [&roots, n, two_pi, inverse](const auto &r) {
+        for (auto k = r.begin(); k != r.end(); ++k) {
+            const auto ang = two_pi * static_cast<double>(k) / static_cast<double>(n);
+            roots[k] = ::std::complex<double>(::std::cos(ang), inverse ? ::std::sin(ang) : -::std::sin(ang));
+        }
+    });
+
+    // The stages. In each stage there are n / 2 independent
+    // butterflies, which are computed in parallel.
+    for (::std::size_t len = 2; len <= n; len <<= 1) {
+        const auto half = len / 2u, step = n / len;
+
+        ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, n / 2u), [&v, &roots, half, step](const auto &r) {
+            for (auto b = r.begin(); b != r.end(); ++b) {
+                const auto j = b % half, i = (b / half) * half * 2u + j;
+
+                const auto u = v[i], t = v[i + half] * roots[j * step];
+                v[i] = u + t;
+                v[i + half] = u - t;
+            }
+        });
+    }
+
+    if (inverse) {
+        ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, n), [&v, n](const auto &r) {
+            for (auto k = r.begin(); k != r.end(); ++k) {
+                v[k] /= static_cast<double>(n);
+            }
+        });
+    }
+}
+
+} // namespace detail
+
+} // namespace obake_py
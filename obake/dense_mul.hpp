@@ -0,0 +1,381 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_DENSE_MUL_HPP
+#define OBAKE_PY_DENSE_MUL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "key_utils.hpp"
+#include "metadata.hpp"
+#include "series_table.hpp"
+#include "sym_merge.hpp"
+
+namespace obake_py
+{
+
+// The multiplication methods.
+enum class mul_method { automatic, sparse, dense };
+
+// Convert a string into a multiplication method.
+mul_method str_to_mul_method(const ::std::string &);
+
+// The maximum number of slots in the dense
+// representation of a product.
+inline constexpr ::std::size_t dense_mul_max_size = ::std::size_t(1) << 24;
+
+namespace detail
+{
+
+// In-place radix-2 FFT of v, whose size must be a power of 2.
+// The butterflies of each stage are computed in parallel.
+void dense_mul_fft(::std::vector<::std::complex<double>> &, bool);
+
+// The Kronecker substitution mapping the terms of a and b into
+// a dense one-dimensional array which can hold their product.
+struct dense_mul_layout {
+    // The output exponent offsets and widths, and the strides.
+    ::std::vector<long long> m_offsets;
+    ::std::vector<::std::size_t> m_widths, m_strides;
+    // The total size of the dense array.
+    ::std::size_t m_size = 1;
+};
+
+// Compute the layout for the product of two series with metadata
+// ma and mb and identical symbol sets. An empty optional is returned
+// if the dense representation would be too large.
+template <typename T>
+inline ::std::optional<dense_mul_layout> dense_mul_make_layout(const series_metadata<T> &ma,
+                                                               const series_metadata<T> &mb)
+{
+    const auto mp = series_metadata_mul(ma, mb);
+    if (!mp) {
+        throw ::std::overflow_error("an overflow in the monomial exponents was detected in a dense multiplication");
+    }
+
+    const auto n = mp->m_ss.size();
+
+    dense_mul_layout retval;
+    retval.m_offsets.resize(n);
+    retval.m_widths.resize(n);
+    retval.m_strides.resize(n);
+
+    for (decltype(mp->m_ss.size()) i = 0; i < n; ++i) {
+        retval.m_offsets[i] = static_cast<long long>(mp->m_min_exps[i]);
+
+        // NOTE: compute the width in unsigned arithmetic,
+        // so that it cannot overflow.
+        const auto w = static_cast<unsigned long long>(mp->m_max_exps[i])
+                       - static_cast<unsigned long long>(mp->m_min_exps[i]) + 1u;
+        if (w > dense_mul_max_size) {
+            return {};
+        }
+        retval.m_widths[i] = static_cast<::std::size_t>(w);
+    }
+
+    // Row-major strides.
+    for (auto i = n; i > 0u; --i) {
+        retval.m_strides[i - 1u] = retval.m_size;
+        if (retval.m_widths[i - 1u] > dense_mul_max_size / retval.m_size) {
+            return {};
+        }
+        retval.m_size *= retval.m_widths[i - 1u];
+    }
+
+    return retval;
+}
+
+// Map the terms of x into dense indices. The offsets of x are
+// given by its own minimum exponents.
+template <typename T>
+inline ::std::vector<::std::pair<::std::size_t, const typename T::cf_type *>>
+dense_mul_indices(const T &x, const series_metadata<T> &md, const dense_mul_layout &layout)
+{
+    using exp_t = typename series_metadata<T>::exp_t;
+
+    const auto &ss = x.get_symbol_set();
+
+    ::std::vector<::std::pair<::std::size_t, const typename T::cf_type *>> retval;
+    retval.reserve(x.size());
+
+    ::std::vector<exp_t> tmp;
+    for (const auto &t : x) {
+        key_unpack(t.first, ss, tmp);
+
+        ::std::size_t idx = 0;
+        for (decltype(tmp.size()) i = 0; i < tmp.size(); ++i) {
+            idx += static_cast<::std::size_t>(static_cast<unsigned long long>(tmp[i])
+                                              - static_cast<unsigned long long>(md.m_min_exps[i]))
+                   * layout.m_strides[i];
+        }
+
+        retval.emplace_back(idx, &t.second);
+    }
+
+    return retval;
+}
+
+} // namespace detail
+
+// Estimate whether a dense multiplication is preferable for the
+// product of two series with ta and tb terms, given the size n
+// of the dense representation of the product.
+inline bool dense_mul_preferable(::std::size_t ta, ::std::size_t tb, ::std::size_t n)
+{
+    const auto n_mults = static_cast<double>(ta) * static_cast<double>(tb);
+
+    // NOTE: three FFTs of size up to 2n.
+    const auto l = 2. * static_cast<double>(n);
+    return 3. * l * ::std::log2(l) < n_mults;
+}
+
+// Dense multiplication of a and b, which must have the same symbol set
+// and double-precision coefficients. The FFT result is exact (i.e., identical
+// to the result of the sparse kernel) if all the coefficients are integral and
+// small enough for the rounding errors to be removed. If force is false, the
+// dense multiplication is performed only if it is exact and deemed preferable,
+// otherwise an empty optional is returned. An empty optional is returned also
+// if the dynamic range of the coefficients is too wide for the FFT
+// to resolve all the contributions to the product.
+template <typename T>
+inline ::std::optional<T> dense_mul(const T &a, const T &b, bool force)
+{
+    using cf_t = typename T::cf_type;
+    using key_t = typename T::key_type;
+    using exp_t = typename series_metadata<T>::exp_t;
+    static_assert(::std::is_same_v<cf_t, double>);
+
+    const auto &ss = a.get_symbol_set();
+
+    if (a.empty() || b.empty()) {
+        T retval;
+        retval.set_symbol_set(ss);
+        return retval;
+    }
+
+    const auto ma = series_metadata_compute(a), mb = series_metadata_compute(b);
+
+    const auto layout = detail::dense_mul_make_layout(ma, mb);
+    if (!layout) {
+        if (force) {
+            throw ::std::invalid_argument("the dense representation of the product of two polynomials would require "
+                                          "more than "
+                                          + ::std::to_string(dense_mul_max_size) + " slots");
+        }
+        return {};
+    }
+
+    if (!force && !dense_mul_preferable(a.size(), b.size(), layout->m_size)) {
+        return {};
+    }
+
+    const auto n = layout->m_size;
+
+    ::std::size_t l = 1;
+    while (l < n) {
+        l <<= 1;
+    }
+
+    // The Euclidean norms and the minimum and maximum absolute
+    // values of the coefficients, and flags signalling
+    // integral coefficients.
+    double a_norm = 0, b_norm = 0, a_min = ::std::numeric_limits<double>::infinity(), b_min = a_min, a_max = 0,
+           b_max = 0;
+    bool a_int = true, b_int = true;
+    for (const auto &t : a) {
+        a_norm += t.second * t.second;
+        a_min = ::std::min(a_min, ::std::abs(t.second));
+        a_max = ::std::max(a_max, ::std::abs(t.second));
+        a_int = a_int && t.second == ::std::trunc(t.second);
+    }
+    for (const auto &t : b) {
+        b_norm += t.second * t.second;
+        b_min = ::std::min(b_min, ::std::abs(t.second));
+        b_max = ::std::max(b_max, ::std::abs(t.second));
+        b_int = b_int && t.second == ::std::trunc(t.second);
+    }
+
+    // The error of the FFT-based convolution is bounded (roughly) by
+    // eps * log2(l) * |a| * |b|, where |a| and |b| are the Euclidean
+    // norms of the inputs (including the indicator functions).
+    const auto eps = ::std::numeric_limits<double>::epsilon();
+    const auto fft_err = eps * ::std::log2(static_cast<double>(l) + 1.)
+                         * ::std::sqrt(a_norm + static_cast<double>(a.size()))
+                         * ::std::sqrt(b_norm + static_cast<double>(b.size()));
+
+    // The product is exact if the coefficients are integral, if the
+    // sparse kernel computes the product without rounding (i.e., all
+    // the partial sums are below 2**53), and if the error of the FFT
+    // is small enough to be removed by rounding to the nearest integer.
+    const auto exact = a_int && b_int
+                       && a_max * b_max * static_cast<double>(::std::min(a.size(), b.size())) <= 0x1p53
+                       && fft_err <= 1. / 64;
+
+    if (!exact) {
+        if (!force) {
+            // NOTE: the automatic method must
+            // not alter the result.
+            return {};
+        }
+
+        // Check the dynamic range of the coefficients. If the error of
+        // the FFT is not negligible with respect to the smallest product
+        // of two coefficients, the contributions to the product
+        // cannot be resolved reliably.
+        if (!(fft_err <= ::std::sqrt(eps) * a_min * b_min)) {
+            return {};
+        }
+    }
+
+    const auto a_idx = detail::dense_mul_indices(a, ma, *layout);
+    const auto b_idx = detail::dense_mul_indices(b, mb, *layout);
+
+    // Kronecker substitution + FFT. Two real convolutions are computed
+    // at once: the convolution of the coefficients and the convolution
+    // of the indicator functions of the terms (which tells
+    // which slots of the product are populated).
+    ::std::vector<::std::complex<double>> x(l), y(l);
+    for (const auto &[i, c] : a_idx) {
+        x[i] = ::std::complex<double>(*c, 1.);
+    }
+    for (const auto &[i, c] : b_idx) {
+        y[i] = ::std::complex<double>(*c, 1.);
+    }
+
+    detail::dense_mul_fft(x, false);
+    detail::dense_mul_fft(y, false);
+
+    // Split the transforms of the real and imaginary parts
+    // exploiting the conjugate symmetry of the transforms
+    // of real sequences.
+    ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, l), [&x, &y, l](const auto &r) {
+        const ::std::complex<double> i_unit(0., 1.);
+
+        for (auto k = r.begin(); k != r.end(); ++k) {
+            if ((l - k) % l < k) {
+                // NOTE: computed together with the symmetric index.
+                continue;
+            }
+
+            const auto k2 = (l - k) % l;
+
+            const auto xk = x[k], xk2 = x[k2], yk = y[k], yk2 = y[k2];
+
+            const auto fa = (xk + ::std::conj(xk2)) * .5, fsa = (xk - ::std::conj(xk2)) * (-.5 * i_unit);
+            const auto fb = (yk + ::std::conj(yk2)) * .5, fsb = (yk - ::std::conj(yk2)) * (-.5 * i_unit);
+            x[k] = fa * fb + i_unit * (fsa * fsb);
+
+            if (k2 != k) {
+                x[k2] = ::std::conj(fa) * ::std::conj(fb) + i_unit * (::std::conj(fsa) * ::std::conj(fsb));
+            }
+        }
+    });
+
+    detail::dense_mul_fft(x, true);
+
+    // The dense output coefficients, and flags signalling the slots
+    // which received contributions. NOTE: in the exact case, the
+    // coefficients are rounded to the nearest integer and exact
+    // cancellations are detected. Otherwise, the slots are selected only
+    // via the indicator functions, so that no coefficient is ever
+    // dropped because of its magnitude, and contributions which cancel
+    // out exactly leave a residual of the order of the rounding error.
+    ::std::vector<cf_t> out(n);
+    ::std::vector<char> present(n);
+    for (::std::size_t k = 0; k < n; ++k) {
+        if (exact) {
+            out[k] = ::std::nearbyint(x[k].real());
+            present[k] = x[k].imag() > .5 && out[k] != 0;
+        } else {
+            out[k] = x[k].real();
+            present[k] = x[k].imag() > .5;
+        }
+    }
+
+    // Assemble the result.
+    T retval;
+    retval.set_symbol_set(ss);
+    series_reserve(retval, static_cast<unsigned long long>(::std::count(present.begin(), present.end(), char(1))));
+
+    ::std::vector<exp_t> tmp(ss.size());
+    for (::std::size_t k = 0; k < n; ++k) {
+        if (!present[k]) {
+            continue;
+        }
+
+        for (decltype(tmp.size()) i = 0; i < tmp.size(); ++i) {
+            tmp[i] = static_cast<exp_t>(static_cast<long long>((k / layout->m_strides[i]) % layout->m_widths[i])
+                                        + layout->m_offsets[i]);
+        }
+
+        retval.add_term(key_pack<key_t>(tmp), ::std::move(out[k]));
+    }
+
+    return retval;
+}
+
+// Multiplication of a and b via the method mm.
+// NOTE: the dense multiplication is available only for
+// double-precision coefficients, and the automatic method
+// selects it only if the result is identical to the result
+// of the sparse kernel. For the other coefficient types,
+// the automatic method always selects the sparse one.
+template <typename T>
+inline T mul_with_method(const T &a, const T &b, mul_method mm)
+{
+    if constexpr (::std::is_same_v<typename T::cf_type, double>) {
+        if (mm == mul_method::sparse) {
+            return a * b;
+        }
+
+        // NOTE: the dense multiplication needs
+        // a common symbol set.
+        const auto ss = sym_union(a.get_symbol_set(), b.get_symbol_set());
+
+        ::std::optional<T> a_ext, b_ext;
+        if (a.get_symbol_set() != ss) {
+            a_ext.emplace(a);
+            sym_extend(*a_ext, ss);
+        }
+        if (b.get_symbol_set() != ss) {
+            b_ext.emplace(b);
+            sym_extend(*b_ext, ss);
+        }
+
+        auto ret = dense_mul(a_ext ? *a_ext : a, b_ext ? *b_ext : b, mm == mul_method::dense);
+        if (ret) {
+            return ::std::move(*ret);
+        }
+
+        return a * b;
+    } else {
+        if (mm == mul_method::dense) {
+            throw ::std::invalid_argument("the dense multiplication method is available only for polynomials with "
+                                          "double-precision coefficients");
+        }
+
+        return a * b;
+    }
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,362 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_ESTIMATE_HPP
+#define OBAKE_PY_ESTIMATE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <mp++/integer.hpp>
+#include <mp++/rational.hpp>
+
+#include <obake/byte_size.hpp>
+#include <obake/hash.hpp>
+#include <obake/key/key_degree.hpp>
+#include <obake/polynomials/monomial_mul.hpp>
+#include <obake/polynomials/monomial_range_overflow_check.hpp>
+#include <obake/symbols.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "key_utils.hpp"
+#include "metadata.hpp"
+#include "sym_merge.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace detail
+{
+
+// Hasher for the keys of a series.
+struct estimate_key_hasher {
+    template <typename K>
+    ::std::size_t operator()(const K &k) const
+    {
+        return static_cast<::std::size_t>(::obake::hash(k));
+    }
+};
+
+} // namespace detail
+
+// Estimate the number of terms in the product of a and b, which must
+// have the same symbol set. If max_degree is provided, only the term pairs
+// whose degree does not exceed max_degree are considered. If the number of
+// term pairs is small, the number of distinct keys is counted exactly.
+// Otherwise, a sample of random term pairs is drawn, and the number of
+// distinct keys in the product is estimated from the numbers of keys seen
+// once and twice in the sample via the bias-corrected Chao1 estimator.
+// NOTE: unlike estimators based on the first repetition of a key, this
+// estimator accounts for the skew of the distribution of the keys (i.e.,
+// the keys produced by many term pairs do not hide the keys
+// produced by few term pairs).
+template <typename T>
+inline unsigned long long estimate_product_size(const T &a, const T &b,
+                                                const ::std::optional<series_degree_t<T>> &max_degree = {})
+{
+    using key_t = typename T::key_type;
+    using deg_t = series_degree_t<T>;
+
+    if (a.empty() || b.empty()) {
+        return 0;
+    }
+
+    const auto &ss = a.get_symbol_set();
+
+    ::std::vector<key_t> a_keys, b_keys;
+    a_keys.reserve(a.size());
+    b_keys.reserve(b.size());
+    for (const auto &t : a) {
+        a_keys.push_back(t.first);
+    }
+    for (const auto &t : b) {
+        b_keys.push_back(t.first);
+    }
+
+    if (!::obake::monomial_range_overflow_check(a_keys, b_keys, ss)) {
+        throw ::std::overflow_error("an overflow in the monomial exponents was detected while estimating the size of "
+                                    "the product of two polynomials");
+    }
+
+    // The number of terms of b (sorted by degree) which can be
+    // paired with each term of a, and its cumulative sum.
+    ::std::vector<unsigned long long> n_cols(a_keys.size(), b_keys.size()), cum(a_keys.size());
+    if (max_degree) {
+        ::std::vector<::std::pair<deg_t, key_t>> tmp;
+        tmp.reserve(b_keys.size());
+        for (auto &k : b_keys) {
+            tmp.emplace_back(deg_t(::obake::key_degree(k, ss)), ::std::move(k));
+        }
+        ::std::sort(tmp.begin(), tmp.end(), [](const auto &p1, const auto &p2) { return p1.first < p2.first; });
+
+        ::std::vector<deg_t> b_degs;
+        b_degs.reserve(tmp.size());
+        for (decltype(tmp.size()) j = 0; j < tmp.size(); ++j) {
+            b_degs.push_back(tmp[j].first);
+            b_keys[j] = ::std::move(tmp[j].second);
+        }
+
+        for (decltype(a_keys.size()) i = 0; i < a_keys.size(); ++i) {
+            const deg_t da(::obake::key_degree(a_keys[i], ss));
+            n_cols[i] = static_cast<unsigned long long>(
+                ::std::partition_point(b_degs.begin(), b_degs.end(),
+                                       [&da, &max_degree](const deg_t &db) { return !(*max_degree < da + db); })
+                - b_degs.begin());
+        }
+    }
+    unsigned long long n_pairs = 0;
+    for (decltype(n_cols.size()) i = 0; i < n_cols.size(); ++i) {
+        n_pairs += n_cols[i];
+        cum[i] = n_pairs;
+    }
+
+    if (n_pairs == 0u) {
+        return 0;
+    }
+
+    // NOTE: the size of the sample is capped, so
+    // that the cost of the estimate remains bounded.
+    constexpr unsigned long long max_sample = 1ull << 16;
+
+    ::std::unordered_map<key_t, unsigned long long, detail::estimate_key_hasher> counts;
+
+    if (n_pairs <= max_sample) {
+        // Count the distinct keys exactly.
+        key_t tmp(ss);
+        for (decltype(a_keys.size()) i = 0; i < a_keys.size(); ++i) {
+            for (unsigned long long j = 0; j < n_cols[i]; ++j) {
+                ::obake::monomial_mul(tmp, a_keys[i], b_keys[static_cast<decltype(b_keys.size())>(j)], ss);
+                counts.emplace(tmp, 0);
+            }
+        }
+
+        return static_cast<unsigned long long>(counts.size());
+    }
+
+    // Draw the sample in parallel, in a fixed number of chunks.
+    constexpr unsigned n_chunks = 16;
+    ::std::vector<decltype(counts)> c_counts(n_chunks);
+
+    ::tbb::parallel_for(::tbb::blocked_range<unsigned>(0, n_chunks), [&](const auto &r) {
+        key_t tmp(ss);
+
+        for (auto c = r.begin(); c != r.end(); ++c) {
+            // NOTE: use a deterministic seed, so that the
+            // estimate is reproducible.
+            ::std::mt19937_64 rng(c);
+            ::std::uniform_int_distribution<unsigned long long> dist(0, n_pairs - 1u);
+
+            for (auto n = 0ull; n < max_sample / n_chunks; ++n) {
+                // Map a uniformly-distributed pair index
+                // to a (term of a, term of b) pair.
+                const auto idx = dist(rng);
+                const auto i = static_cast<decltype(a_keys.size())>(::std::upper_bound(cum.begin(), cum.end(), idx)
+                                                                     - cum.begin());
+                const auto j = static_cast<decltype(b_keys.size())>(idx - (cum[i] - n_cols[i]));
+
+                ::obake::monomial_mul(tmp, a_keys[i], b_keys[j], ss);
+                ++c_counts[c][tmp];
+            }
+        }
+    });
+
+    for (auto &cc : c_counts) {
+        for (auto &[k, n] : cc) {
+            counts[k] += n;
+        }
+    }
+
+    // The number of distinct keys, and the numbers of
+    // keys seen exactly once and twice.
+    double d = 0, f1 = 0, f2 = 0;
+    for (const auto &[k, n] : counts) {
+        d += 1;
+        f1 += n == 1u;
+        f2 += n == 2u;
+    }
+
+    const auto est = ::std::min(static_cast<double>(n_pairs), d + f1 * (f1 - 1.) / (2. * (f2 + 1.)));
+
+    return static_cast<unsigned long long>(::std::max(1., ::std::round(est)));
+}
+
+// Estimate the average number of bytes per term in the product
+// of a and b, from the average sizes of the terms of a and b.
+template <typename T>
+inline double estimate_term_byte_size(const T &a, const T &b)
+{
+    double retval = static_cast<double>(sizeof(typename T::key_type) + sizeof(typename T::cf_type));
+
+    if (!a.empty()) {
+        retval = ::std::max(retval, static_cast<double>(::obake::byte_size(a)) / static_cast<double>(a.size()));
+    }
+    if (!b.empty()) {
+        retval = ::std::max(retval, static_cast<double>(::obake::byte_size(b)) / static_cast<double>(b.size()));
+    }
+
+    return retval;
+}
+
+// Estimate the number of terms and the number of bytes
+// of the product of a and b, optionally truncated
+// to the degree max_degree.
+template <typename T>
+inline ::std::pair<unsigned long long, double>
+estimate_product(const T &a, const T &b, const ::std::optional<series_degree_t<T>> &max_degree = {})
+{
+    // NOTE: the sampling needs a common symbol set.
+    const auto ss = sym_union(a.get_symbol_set(), b.get_symbol_set());
+
+    ::std::optional<T> a_ext, b_ext;
+    if (a.get_symbol_set() != ss) {
+        a_ext.emplace(a);
+        sym_extend(*a_ext, ss);
+    }
+    if (b.get_symbol_set() != ss) {
+        b_ext.emplace(b);
+        sym_extend(*b_ext, ss);
+    }
+    const auto &a_ref = a_ext ? *a_ext : a;
+    const auto &b_ref = b_ext ? *b_ext : b;
+
+    const auto n = estimate_product_size(a_ref, b_ref, max_degree);
+
+    return {n, static_cast<double>(n) * estimate_term_byte_size(a_ref, b_ref)};
+}
+
+namespace detail
+{
+
+// Binomial coefficient, in floating-point arithmetic.
+inline double estimate_binomial(double n, double k)
+{
+    return ::std::exp(::std::lgamma(n + 1.) - ::std::lgamma(k + 1.) - ::std::lgamma(n - k + 1.));
+}
+
+} // namespace detail
+
+// Convert the exponent of a power into a long long,
+// if it is integral and representable.
+template <typename U>
+inline ::std::optional<long long> estimate_pow_exponent(const U &n)
+{
+    if constexpr (::std::is_same_v<U, ::mppp::integer<1>>) {
+        long long retval;
+        if (::mppp::get(retval, n)) {
+            return retval;
+        }
+        return {};
+    } else if constexpr (::std::is_same_v<U, ::mppp::rational<1>>) {
+        if (n.get_den().is_one()) {
+            return estimate_pow_exponent(n.get_num());
+        }
+        return {};
+    } else {
+        const auto d = static_cast<double>(n);
+        if (::std::isfinite(d) && d == ::std::floor(d) && ::std::abs(d) < 1E18) {
+            return static_cast<long long>(d);
+        }
+        return {};
+    }
+}
+
+// Estimate the number of terms and the number of bytes of x**n.
+// The estimate is the smallest of a few upper bounds: the number of
+// multisets of n terms of x, and the number of monomials compatible
+// with the degree and exponent ranges of x**n.
+template <typename T>
+inline ::std::pair<unsigned long long, double> estimate_pow(const T &x, long long n)
+{
+    if (n == 0 || x.empty()) {
+        return {1, estimate_term_byte_size(x, x)};
+    }
+
+    const auto md = series_metadata_compute(x);
+    const auto n_abs = static_cast<double>(n < 0 ? -n : n);
+    const auto n_terms = static_cast<double>(x.size());
+
+    auto est = detail::estimate_binomial(n_terms + n_abs - 1., n_abs);
+
+    double box = 1;
+    bool non_negative = true;
+    for (decltype(md.m_min_exps.size()) i = 0; i < md.m_min_exps.size(); ++i) {
+        box *= n_abs * static_cast<double>(md.m_max_exps[i] - md.m_min_exps[i]) + 1.;
+        non_negative = non_negative && md.m_min_exps[i] >= 0;
+    }
+    est = ::std::min(est, box);
+
+    if (non_negative) {
+        const auto s = static_cast<double>(md.m_ss.size());
+        est = ::std::min(est, detail::estimate_binomial(n_abs * static_cast<double>(md.m_max_degree) + s, s));
+    }
+
+    est = ::std::max(1., ::std::round(est));
+
+    return {static_cast<unsigned long long>(::std::min(est, 1E19)), est * estimate_term_byte_size(x, x)};
+}
+
+// Estimate the number of terms and the number of bytes of the substitution
+// of the symbols of x with the series in sm. Each term of x contributes at most
+// as many terms as the number of multisets of the terms of the substituted
+// series, which yields an upper bound.
+template <typename T>
+inline ::std::pair<unsigned long long, double> estimate_subs(const T &x, const ::obake::symbol_map<T> &sm)
+{
+    using exp_t = typename series_metadata<T>::exp_t;
+
+    const auto &ss = x.get_symbol_set();
+
+    // The number of terms of the series replacing
+    // each symbol of x (zero if not replaced).
+    ::std::vector<double> sizes;
+    auto term_bytes = estimate_term_byte_size(x, x);
+    for (const auto &s : ss) {
+        const auto it = sm.find(s);
+        if (it == sm.end()) {
+            sizes.push_back(0);
+        } else {
+            sizes.push_back(static_cast<double>(it->second.size()));
+            term_bytes = ::std::max(term_bytes, estimate_term_byte_size(it->second, it->second));
+        }
+    }
+
+    double est = 0;
+    ::std::vector<exp_t> tmp;
+    for (const auto &t : x) {
+        key_unpack(t.first, ss, tmp);
+
+        double cur = 1;
+        for (decltype(tmp.size()) i = 0; i < tmp.size(); ++i) {
+            if (sizes[i] != 0 && tmp[i] != 0) {
+                const auto e = static_cast<double>(tmp[i] < 0 ? -tmp[i] : tmp[i]);
+                cur *= detail::estimate_binomial(sizes[i] + e - 1., e);
+            }
+        }
+
+        est += cur;
+    }
+
+    est = ::std::max(1., ::std::round(est));
+
+    return {static_cast<unsigned long long>(::std::min(est, 1E19)), est * term_bytes};
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,151 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_EVALUATE_MANY_HPP
+#define OBAKE_PY_EVALUATE_MANY_HPP
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <obake/math/evaluate.hpp>
+#include <obake/math/pow.hpp>
+#include <obake/symbols.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "key_utils.hpp"
+#include "metadata.hpp"
+#include "sym_merge.hpp"
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+// Evaluate the series in v with the values in sm. The integral powers of the
+// values needed by the series are computed once, and shared by all the
+// evaluations. The metadata of the series is used to determine the ranges
+// of the powers.
+template <typename T, typename U>
+inline auto evaluate_many(const ::std::vector<const T *> &v, const ::obake::symbol_map<U> &sm)
+{
+    using ret_t = decltype(::obake::evaluate(*v[0], sm));
+    using exp_t = typename series_metadata<T>::exp_t;
+
+    // Compute the metadata.
+    // NOTE: the cached metadata is not used here, as the
+    // power tables are indexed via the exponent bounds and
+    // a stale cache would lead to out-of-bounds accesses.
+    ::std::vector<series_metadata<T>> mds(v.size());
+    ::tbb::parallel_for(::tbb::blocked_range<decltype(v.size())>(0, v.size()), [&v, &mds](const auto &r) {
+        for (auto i = r.begin(); i != r.end(); ++i) {
+            mds[i] = series_metadata_compute(*v[i]);
+        }
+    });
+
+    // Determine the global symbol set and the exponent ranges.
+    ::obake::symbol_set ss;
+    for (const auto *p : v) {
+        ss = sym_union(ss, p->get_symbol_set());
+    }
+
+    ::std::vector<exp_t> min_exps(ss.size()), max_exps(ss.size());
+    for (const auto &md : mds) {
+        decltype(md.m_ss.size()) i = 0;
+        for (const auto &s : md.m_ss) {
+            const auto idx = ss.index_of(ss.find(s));
+            min_exps[idx] = ::std::min(min_exps[idx], md.m_min_exps[i]);
+            max_exps[idx] = ::std::max(max_exps[idx], md.m_max_exps[i]);
+            ++i;
+        }
+    }
+
+    // Check that all the symbols have a value.
+    for (const auto &s : ss) {
+        if (sm.find(s) == sm.end()) {
+            throw ::std::invalid_argument("cannot evaluate a list of polynomials: the evaluation map does not "
+                                          "contain the symbol '"
+                                          + s + "'");
+        }
+    }
+
+    // Build the tables of powers. Each table contains the powers
+    // of a value from the minimum to the maximum exponent.
+    // NOTE: the minimum exponents are non-positive and the maximum
+    // exponents are non-negative. The tables are built starting from
+    // the exponent zero in both directions, so that the non-negative
+    // powers of a null value are not computed from
+    // its (infinite or undefined) negative powers.
+    ::std::vector<::std::vector<U>> p_tables(ss.size());
+    ::tbb::parallel_for(::tbb::blocked_range<decltype(ss.size())>(0, ss.size()),
+                        [&ss, &sm, &min_exps, &max_exps, &p_tables](const auto &r) {
+                            for (auto i = r.begin(); i != r.end(); ++i) {
+                                const auto &val = sm.find(*ss.nth(i))->second;
+                                auto &tab = p_tables[i];
+
+                                using size_type = typename ::std::vector<U>::size_type;
+                                const auto z = static_cast<size_type>(-min_exps[i]);
+
+                                tab.resize(static_cast<size_type>(max_exps[i] - min_exps[i]) + 1u, U(1));
+                                for (size_type e = 1; e <= static_cast<size_type>(max_exps[i]); ++e) {
+                                    tab[z + e] = tab[z + e - 1u] * val;
+                                }
+                                if (z != 0u) {
+                                    const U inv(::obake::pow(val, exp_t(-1)));
+                                    for (size_type e = 1; e <= z; ++e) {
+                                        tab[z - e] = tab[z - e + 1u] * inv;
+                                    }
+                                }
+                            }
+                        });
+
+    // Evaluate the series in parallel.
+    ::std::vector<ret_t> retval(v.size());
+    ::tbb::parallel_for(::tbb::blocked_range<decltype(v.size())>(0, v.size()), [&](const auto &r) {
+        ::std::vector<exp_t> tmp;
+        ::std::vector<decltype(ss.size())> idx_map;
+
+        for (auto i = r.begin(); i != r.end(); ++i) {
+            const auto &p = *v[i];
+            const auto &p_ss = p.get_symbol_set();
+
+            // Map the symbols of p to the global symbol set.
+            idx_map.clear();
+            for (const auto &s : p_ss) {
+                idx_map.push_back(ss.index_of(ss.find(s)));
+            }
+
+            ret_t acc(0);
+            for (const auto &t : p) {
+                key_unpack(t.first, p_ss, tmp);
+
+                U prod(1);
+                for (decltype(tmp.size()) j = 0; j < tmp.size(); ++j) {
+                    const auto gi = idx_map[j];
+                    prod *= p_tables[gi][static_cast<decltype(p_tables[gi].size())>(tmp[j] - min_exps[gi])];
+                }
+
+                acc += t.second * prod;
+            }
+
+            retval[i] = ::std::move(acc);
+        }
+    });
+
+    return retval;
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,146 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_FROZEN_HPP
+#define OBAKE_PY_FROZEN_HPP
+
+#include <cstddef>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "key_utils.hpp"
+#include "type_system.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+// Hash a series. Series with different symbol sets
+// may compare equal, thus the hash of a key is computed
+// from the (symbol name, exponent) pairs of its nonzero
+// exponents (which do not depend on the symbol set), in the
+// order of the symbol names. The hash of a term combines the hash
+// of its coefficient with the hash of its key, and the hashes of the
+// terms are then summed, so that the result does not depend on
+// the order of the terms in the table.
+template <typename T>
+inline ::std::size_t series_hash(const T &x)
+{
+    using exp_t = typename T::key_type::value_type;
+
+    const auto &s_table = x._get_s_table();
+    const auto &ss = x.get_symbol_set();
+
+    // The hashes of the symbol names.
+    ::std::vector<::std::size_t> ss_hashes;
+    ss_hashes.reserve(ss.size());
+    for (const auto &s : ss) {
+        ss_hashes.push_back(::std::hash<::std::string>{}(s));
+    }
+
+    ::std::vector<::std::size_t> s_hashes(s_table.size());
+
+    ::tbb::parallel_for(::tbb::blocked_range<decltype(s_table.size())>(0, s_table.size()),
+                        [&s_table, &ss, &ss_hashes, &s_hashes](const auto &r) {
+                            ::std::vector<exp_t> tmp;
+
+                            for (auto i = r.begin(); i != r.end(); ++i) {
+                                ::std::size_t h = 0;
+
+                                for (const auto &[k, c] : s_table[i]) {
+                                    key_unpack(k, ss, tmp);
+
+                                    ::std::size_t k_hash = 0;
+                                    for (decltype(tmp.size()) j = 0; j < tmp.size(); ++j) {
+                                        if (tmp[j] != exp_t(0)) {
+                                            ::boost::hash_combine(k_hash, ss_hashes[j]);
+                                            ::boost::hash_combine(k_hash, tmp[j]);
+                                        }
+                                    }
+
+                                    auto t_hash = ::std::hash<typename T::cf_type>{}(c);
+                                    ::boost::hash_combine(t_hash, k_hash);
+                                    h += t_hash;
+                                }
+
+                                s_hashes[i] = h;
+                            }
+                        });
+
+    return ::std::accumulate(s_hashes.begin(), s_hashes.end(), ::std::size_t(0));
+}
+
+// Immutable wrapper around a series,
+// with cached hash.
+template <typename T>
+struct frozen_series {
+    explicit frozen_series(const T &x) : m_value(x), m_hash(series_hash(m_value)) {}
+
+    T m_value;
+    ::std::size_t m_hash;
+};
+
+template <typename T>
+inline bool operator==(const frozen_series<T> &a, const frozen_series<T> &b)
+{
+    // NOTE: compare first the cheap bits.
+    return a.m_hash == b.m_hash && a.m_value.size() == b.m_value.size() && a.m_value == b.m_value;
+}
+
+// Expose the frozen wrapper for the series type T.
+template <typename T>
+inline void expose_frozen(py::module &m)
+{
+    using f_type = frozen_series<T>;
+
+    // NOTE: don't use the _exposed_type_ prefix, as the
+    // hashing method is removed from exposed types
+    // with that prefix.
+    py::class_<f_type> class_inst(m, ("_frozen_type_" + ::std::to_string(exposed_types_counter++)).c_str());
+
+    class_inst.def("__repr__", [](const f_type &f) { return "frozen(" + repr_ostr(f.m_value) + ")"; });
+    class_inst.def("__len__", [](const f_type &f) { return f.m_value.size(); });
+    // NOTE: frozen objects are immutable,
+    // no need to copy them.
+    class_inst.def("__copy__", [](const py::object &self) { return self; });
+    class_inst.def("__deepcopy__", [](const py::object &self, const py::dict &) { return self; });
+
+    // Comparisons and hashing.
+    class_inst.def(
+        "__eq__", [](const f_type &a, const f_type &b) { return a == b; }, py::is_operator());
+    class_inst.def(
+        "__ne__", [](const f_type &a, const f_type &b) { return !(a == b); }, py::is_operator());
+    class_inst.def("__hash__", [](const f_type &f) { return f.m_hash; });
+
+    // Accessors.
+    class_inst.def_property_readonly("value", [](const f_type &f) { return f.m_value; });
+    class_inst.def_property_readonly("symbol_set",
+                                     [](const f_type &f) { return obake_ss_to_py_list(f.m_value.get_symbol_set()); });
+
+    // Factory function.
+    m.def("frozen", [](const T &x) {
+        py::gil_scoped_release release;
+
+        return f_type(x);
+    });
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,94 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <atomic>
+#include <cmath>
+#include <string>
+
+#include <pybind11/pybind11.h>
+
+#include "interrupt.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The progress callback and the minimum interval between two
+// invocations. They are protected by the GIL.
+// NOTE: the callback is never destroyed, as it might outlive
+// the Python interpreter.
+py::object *progress_cb = new py::object(py::none());
+double progress_interval = 0.5;
+
+} // namespace
+
+} // namespace detail
+
+void set_progress_callback(const py::object &cb, double interval)
+{
+    if (!cb.is_none() && !::PyCallable_Check(cb.ptr())) {
+        py_throw(::PyExc_TypeError, "the progress callback must be either None or a callable");
+    }
+
+    if (!::std::isfinite(interval) || interval < 0) {
+        py_throw(::PyExc_ValueError,
+                 ("the interval between two invocations of the progress callback must be a finite non-negative "
+                  "number, but a value of "
+                  + ::std::to_string(interval) + " was specified instead")
+                     .c_str());
+    }
+
+    *detail::progress_cb = cb;
+    detail::progress_interval = interval;
+}
+
+py::tuple get_progress_callback()
+{
+    return py::make_tuple(*detail::progress_cb, detail::progress_interval);
+}
+
+bool interrupt_poll(const char *op, const interrupt_state &st, double elapsed, double &last_cb)
+{
+    if (::PyErr_CheckSignals() == -1) {
+        return false;
+    }
+
+    const auto &cb = *detail::progress_cb;
+    if (cb.is_none() || elapsed - last_cb < detail::progress_interval) {
+        return true;
+    }
+    last_cb = elapsed;
+
+    // NOTE: the fraction of work done is
+    // None if the operation does not report it.
+    const auto total = st.m_total.load(::std::memory_order_relaxed);
+    py::object frac = py::none();
+    if (total != 0u) {
+        frac = py::float_(static_cast<double>(st.m_done.load(::std::memory_order_relaxed))
+                          / static_cast<double>(total));
+    }
+
+    try {
+        cb(op, frac, elapsed);
+    } catch (py::error_already_set &e) {
+        // NOTE: an error raised by the callback
+        // cancels the operation.
+        e.restore();
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace obake_py
@@ -0,0 +1,206 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_INTERRUPT_HPP
+#define OBAKE_PY_INTERRUPT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <obake/symbols.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+// Exception thrown by the kernels which detect
+// that their computation was cancelled.
+struct interrupt_cancelled {
+};
+
+// Shared state of an interruptible operation. The kernels which
+// are aware of the state can report their progress (in arbitrary
+// units of work, out of m_total), and check for cancellation.
+struct interrupt_state {
+    ::std::atomic<bool> m_cancelled = false;
+    ::std::atomic<unsigned long long> m_done = 0, m_total = 0;
+
+    void check() const
+    {
+        if (m_cancelled.load(::std::memory_order_relaxed)) {
+            throw interrupt_cancelled{};
+        }
+    }
+    void progress(unsigned long long n)
+    {
+        m_done.fetch_add(n, ::std::memory_order_relaxed);
+    }
+};
+
+// The amount of work (roughly, in number of term-by-term
+// operations) below which the operations run inline,
+// without checking for signals.
+inline constexpr double interrupt_min_work = 1E6;
+
+// The interval between two checks for signals.
+inline constexpr auto interrupt_poll_interval = ::std::chrono::milliseconds(50);
+
+// Estimates of the work of the product of a and b, of x**n
+// (if n is integral, otherwise an empty optional must be
+// passed) and of the substitution of the symbols of x with
+// the values in sm (either series of type T or scalars).
+template <typename T>
+inline double interrupt_mul_work(const T &a, const T &b)
+{
+    return static_cast<double>(a.size()) * static_cast<double>(b.size());
+}
+
+template <typename T>
+inline double interrupt_pow_work(const T &x, const ::std::optional<long long> &n)
+{
+    if (!n) {
+        return static_cast<double>(x.size());
+    }
+
+    const auto n_abs = static_cast<double>(*n < 0 ? -*n : *n);
+
+    return static_cast<double>(x.size()) * static_cast<double>(x.size()) * n_abs;
+}
+
+template <typename T, typename U>
+inline double interrupt_subs_work(const T &x, const ::obake::symbol_map<U> &sm)
+{
+    double retval = 1;
+    if constexpr (::std::is_same_v<U, T>) {
+        for (const auto &p : sm) {
+            retval = ::std::max(retval, static_cast<double>(p.second.size()));
+        }
+    }
+
+    return static_cast<double>(x.size()) * retval * retval;
+}
+
+// Set/get the progress callback and the minimum
+// interval (in seconds) between two invocations.
+// The callback is invoked as cb(op, fraction, elapsed),
+// where fraction is None if the operation does not
+// report its progress.
+void set_progress_callback(const py::object &, double);
+py::tuple get_progress_callback();
+
+// Check for signals and invoke the progress callback (if due)
+// for the operation op, which has been running for elapsed
+// seconds. Returns false if a Python exception was raised.
+// NOTE: this must be called with the GIL held.
+bool interrupt_poll(const char *, const interrupt_state &, double, double &);
+
+// Run f(st), where st is an interrupt_state, on behalf of the
+// operation op. If work is small (or if there are no TBB worker threads)
+// f is run inline. Otherwise, f runs in a TBB task group while the calling
+// thread waits, checking periodically for signals (e.g., Ctrl-C) and
+// invoking the progress callback. If a signal handler raises, the task
+// group is cancelled (which stops the TBB parallel algorithms invoked
+// by f), the partial results are destroyed and the Python exception
+// is propagated.
+// NOTE: this must be called with the GIL held, and f() must not
+// interact with Python.
+template <typename F>
+inline auto run_interruptible(const char *op, double work, F &&f)
+{
+    interrupt_state st;
+
+    if (work < interrupt_min_work || ::tbb::this_task_arena::max_concurrency() < 2) {
+        py::gil_scoped_release release;
+
+        return f(st);
+    }
+
+    ::std::optional<decltype(f(st))> res;
+    ::std::exception_ptr eptr;
+
+    ::std::mutex mtx;
+    ::std::condition_variable cv;
+    bool done = false;
+
+    ::tbb::task_group tg;
+    tg.run([&]() {
+        try {
+            res.emplace(f(st));
+        } catch (...) {
+            eptr = ::std::current_exception();
+        }
+
+        {
+            ::std::lock_guard lock(mtx);
+            done = true;
+        }
+        cv.notify_one();
+    });
+
+    const auto start = ::std::chrono::steady_clock::now();
+    double last_cb = 0;
+
+    while (true) {
+        {
+            py::gil_scoped_release release;
+
+            ::std::unique_lock lock(mtx);
+            if (cv.wait_for(lock, interrupt_poll_interval, [&done]() { return done; })) {
+                break;
+            }
+        }
+
+        const auto elapsed = ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - start).count();
+        if (!interrupt_poll(op, st, elapsed, last_cb)) {
+            st.m_cancelled.store(true, ::std::memory_order_relaxed);
+            tg.cancel();
+
+            {
+                py::gil_scoped_release release;
+
+                tg.wait();
+            }
+
+            // NOTE: the outcome of the cancelled
+            // computation is discarded.
+            res.reset();
+            eptr = nullptr;
+
+            throw py::error_already_set();
+        }
+    }
+
+    {
+        py::gil_scoped_release release;
+
+        tg.wait();
+    }
+
+    if (eptr) {
+        ::std::rethrow_exception(eptr);
+    }
+
+    return ::std::move(*res);
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,62 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_KEY_UTILS_HPP
+#define OBAKE_PY_KEY_UTILS_HPP
+
+#include <vector>
+
+#include <obake/k_packing.hpp>
+#include <obake/polynomials/d_packed_monomial.hpp>
+#include <obake/polynomials/packed_monomial.hpp>
+#include <obake/symbols.hpp>
+
+namespace obake_py
+{
+
+// Unpack the exponents of the monomial k,
+// whose symbol set is ss, into out.
+template <typename T>
+inline void key_unpack(const ::obake::packed_monomial<T> &k, const ::obake::symbol_set &ss, ::std::vector<T> &out)
+{
+    out.resize(ss.size());
+
+    ::obake::k_unpacker<T> ku(k.get_value(), static_cast<unsigned>(ss.size()));
+    for (auto &e : out) {
+        ku >> e;
+    }
+}
+
+template <typename T, unsigned NBits>
+inline void key_unpack(const ::obake::d_packed_monomial<T, NBits> &k, const ::obake::symbol_set &ss,
+                       ::std::vector<T> &out)
+{
+    constexpr auto psize = ::obake::d_packed_monomial<T, NBits>::psize;
+
+    const auto s_size = ss.size();
+    out.resize(s_size);
+
+    decltype(out.size()) idx = 0;
+    for (const auto &n : k._container()) {
+        ::obake::k_unpacker<T> ku(n, psize);
+        for (auto j = 0u; j < psize && idx < s_size; ++j, ++idx) {
+            ku >> out[idx];
+        }
+    }
+}
+
+// Pack the exponents in v into a monomial of type K.
+template <typename K, typename T>
+inline K key_pack(const ::std::vector<T> &v)
+{
+    return K(v.data(), v.data() + v.size());
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,82 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+
+#include <pybind11/pybind11.h>
+
+#include "memory_budget.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The memory budget, zero if there is no budget.
+::std::atomic<unsigned long long> memory_budget_value(0);
+
+} // namespace
+
+} // namespace detail
+
+void set_memory_budget(const py::object &o)
+{
+    if (o.is_none()) {
+        detail::memory_budget_value.store(0, ::std::memory_order_relaxed);
+        return;
+    }
+
+    const auto n = o.cast<long long>();
+    if (n <= 0) {
+        py_throw(::PyExc_ValueError,
+                 ("the memory budget must be a positive number of bytes, but a value of " + ::std::to_string(n)
+                  + " was specified instead")
+                     .c_str());
+    }
+
+    detail::memory_budget_value.store(static_cast<unsigned long long>(n), ::std::memory_order_relaxed);
+}
+
+py::object get_memory_budget()
+{
+    const auto n = memory_budget();
+
+    if (n == 0u) {
+        return py::none();
+    }
+
+    return py::int_(n);
+}
+
+unsigned long long memory_budget()
+{
+    return detail::memory_budget_value.load(::std::memory_order_relaxed);
+}
+
+void memory_budget_check(double bytes, const char *op)
+{
+    const auto n = memory_budget();
+
+    if (n != 0u && bytes > static_cast<double>(n)) {
+        // NOTE: clamp the estimate for display, as it
+        // might not be representable as an integer.
+        throw memory_budget_error("the estimated memory required by the operation '" + ::std::string(op) + "' ("
+                                  + ::std::to_string(::std::llround(::std::min(bytes, 9E18))) + " bytes) exceeds the memory budget ("
+                                  + ::std::to_string(n) + " bytes)");
+    }
+}
+
+} // namespace obake_py
@@ -0,0 +1,56 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_MEMORY_BUDGET_HPP
+#define OBAKE_PY_MEMORY_BUDGET_HPP
+
+#include <stdexcept>
+#include <string>
+
+#include <pybind11/pybind11.h>
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+// Exception signalling that the estimated memory
+// required by an operation exceeds the memory budget.
+// It is translated into a Python MemoryError.
+class memory_budget_error final : public ::std::runtime_error
+{
+public:
+    using ::std::runtime_error::runtime_error;
+};
+
+// Set/get the memory budget (in bytes). None
+// signals that there is no budget.
+void set_memory_budget(const py::object &);
+py::object get_memory_budget();
+
+// The memory budget, zero if there is no budget.
+unsigned long long memory_budget();
+
+// Throw a memory_budget_error if the estimated number
+// of bytes for the operation op exceeds the memory budget.
+void memory_budget_check(double, const char *);
+
+// Run the memory budget check for the operation op, using
+// the estimate computed by f. f is invoked only
+// if a memory budget was set.
+template <typename F>
+inline void memory_budget_check(const F &f, const char *op)
+{
+    if (memory_budget() != 0u) {
+        memory_budget_check(f().second, op);
+    }
+}
+
+} // namespace obake_py
+
+#endif
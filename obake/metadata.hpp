@@ -0,0 +1,429 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_METADATA_HPP
+#define OBAKE_PY_METADATA_HPP
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <obake/key/key_degree.hpp>
+#include <obake/polynomials/monomial_range_overflow_check.hpp>
+#include <obake/symbols.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "key_utils.hpp"
+#include "sym_merge.hpp"
+#include "type_system.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+// Cached metadata of a series: bounds on the total degree
+// and on the exponents of each symbol. If m_exact is true,
+// the bounds are attained by the terms of the series, otherwise
+// they are only guaranteed to contain the actual values.
+template <typename T>
+struct series_metadata {
+    using deg_t = series_degree_t<T>;
+    using exp_t = typename T::key_type::value_type;
+
+    ::obake::symbol_set m_ss;
+    deg_t m_min_degree = deg_t(0), m_max_degree = deg_t(0);
+    ::std::vector<exp_t> m_min_exps, m_max_exps;
+    bool m_exact = true;
+};
+
+namespace detail
+{
+
+// Overflow-checked addition for the metadata bounds.
+template <typename U>
+inline bool metadata_add(U &out, const U &a, const U &b)
+{
+    if constexpr (::std::is_integral_v<U>) {
+        if ((b > 0 && a > ::std::numeric_limits<U>::max() - b) || (b < 0 && a < ::std::numeric_limits<U>::min() - b)) {
+            return false;
+        }
+    }
+
+    out = a + b;
+
+    return true;
+}
+
+// Fetch the exponent bounds of the symbol s from the metadata md.
+// Symbols which are not in the symbol set of md have null exponents.
+template <typename T>
+inline auto metadata_exp_range(const series_metadata<T> &md, const ::std::string &s)
+{
+    using exp_t = typename series_metadata<T>::exp_t;
+
+    const auto it = md.m_ss.find(s);
+    if (it == md.m_ss.end()) {
+        return ::std::make_pair(exp_t(0), exp_t(0));
+    }
+
+    const auto idx = md.m_ss.index_of(it);
+
+    return ::std::make_pair(md.m_min_exps[idx], md.m_max_exps[idx]);
+}
+
+} // namespace detail
+
+// Compute the metadata of x.
+template <typename T>
+inline series_metadata<T> series_metadata_compute(const T &x)
+{
+    using md_t = series_metadata<T>;
+    using exp_t = typename md_t::exp_t;
+
+    const auto &s_table = x._get_s_table();
+    const auto &ss = x.get_symbol_set();
+
+    // The metadata of the individual segments,
+    // and flags signalling empty segments.
+    ::std::vector<md_t> s_mds(s_table.size());
+    ::std::vector<char> s_empty(s_table.size(), 1);
+
+    ::tbb::parallel_for(::tbb::blocked_range<decltype(s_table.size())>(0, s_table.size()),
+                        [&s_table, &ss, &s_mds, &s_empty](const auto &r) {
+                            ::std::vector<exp_t> tmp;
+
+                            for (auto i = r.begin(); i != r.end(); ++i) {
+                                auto &md = s_mds[i];
+
+                                for (const auto &t : s_table[i]) {
+                                    key_unpack(t.first, ss, tmp);
+                                    const typename md_t::deg_t d(::obake::key_degree(t.first, ss));
+
+                                    if (s_empty[i]) {
+                                        md.m_min_degree = d;
+                                        md.m_max_degree = d;
+                                        md.m_min_exps = tmp;
+                                        md.m_max_exps = tmp;
+                                        s_empty[i] = 0;
+                                    } else {
+                                        md.m_min_degree = ::std::min(md.m_min_degree, d);
+                                        md.m_max_degree = ::std::max(md.m_max_degree, d);
+                                        for (decltype(tmp.size()) j = 0; j < tmp.size(); ++j) {
+                                            md.m_min_exps[j] = ::std::min(md.m_min_exps[j], tmp[j]);
+                                            md.m_max_exps[j] = ::std::max(md.m_max_exps[j], tmp[j]);
+                                        }
+                                    }
+                                }
+                            }
+                        });
+
+    // Merge the metadata of the segments.
+    // NOTE: an empty series has null bounds.
+    md_t retval;
+    retval.m_ss = ss;
+    retval.m_min_exps.resize(ss.size());
+    retval.m_max_exps.resize(ss.size());
+
+    bool empty = true;
+    for (decltype(s_mds.size()) i = 0; i < s_mds.size(); ++i) {
+        if (s_empty[i]) {
+            continue;
+        }
+
+        auto &md = s_mds[i];
+
+        if (empty) {
+            retval.m_min_degree = md.m_min_degree;
+            retval.m_max_degree = md.m_max_degree;
+            retval.m_min_exps = ::std::move(md.m_min_exps);
+            retval.m_max_exps = ::std::move(md.m_max_exps);
+            empty = false;
+        } else {
+            retval.m_min_degree = ::std::min(retval.m_min_degree, md.m_min_degree);
+            retval.m_max_degree = ::std::max(retval.m_max_degree, md.m_max_degree);
+            for (decltype(ss.size()) j = 0; j < ss.size(); ++j) {
+                retval.m_min_exps[j] = ::std::min(retval.m_min_exps[j], md.m_min_exps[j]);
+                retval.m_max_exps[j] = ::std::max(retval.m_max_exps[j], md.m_max_exps[j]);
+            }
+        }
+    }
+
+    return retval;
+}
+
+// Metadata of the sum (or difference) of two series
+// with metadata a and b. The bounds are not exact,
+// as terms may cancel out.
+template <typename T>
+inline ::std::optional<series_metadata<T>> series_metadata_add(const series_metadata<T> &a,
+                                                               const series_metadata<T> &b)
+{
+    series_metadata<T> retval;
+    retval.m_ss = sym_union(a.m_ss, b.m_ss);
+    retval.m_min_degree = ::std::min(a.m_min_degree, b.m_min_degree);
+    retval.m_max_degree = ::std::max(a.m_max_degree, b.m_max_degree);
+    retval.m_exact = false;
+
+    for (const auto &s : retval.m_ss) {
+        const auto ra = detail::metadata_exp_range(a, s), rb = detail::metadata_exp_range(b, s);
+        retval.m_min_exps.push_back(::std::min(ra.first, rb.first));
+        retval.m_max_exps.push_back(::std::max(ra.second, rb.second));
+    }
+
+    return retval;
+}
+
+// Metadata of the product of two series with metadata a
+// and b. An empty optional is returned if the bounds
+// cannot be represented.
+template <typename T>
+inline ::std::optional<series_metadata<T>> series_metadata_mul(const series_metadata<T> &a,
+                                                               const series_metadata<T> &b)
+{
+    series_metadata<T> retval;
+    retval.m_ss = sym_union(a.m_ss, b.m_ss);
+    retval.m_exact = false;
+
+    if (!detail::metadata_add(retval.m_min_degree, a.m_min_degree, b.m_min_degree)
+        || !detail::metadata_add(retval.m_max_degree, a.m_max_degree, b.m_max_degree)) {
+        return {};
+    }
+
+    retval.m_min_exps.resize(retval.m_ss.size());
+    retval.m_max_exps.resize(retval.m_ss.size());
+
+    decltype(retval.m_ss.size()) i = 0;
+    for (const auto &s : retval.m_ss) {
+        const auto ra = detail::metadata_exp_range(a, s), rb = detail::metadata_exp_range(b, s);
+        if (!detail::metadata_add(retval.m_min_exps[i], ra.first, rb.first)
+            || !detail::metadata_add(retval.m_max_exps[i], ra.second, rb.second)) {
+            return {};
+        }
+        ++i;
+    }
+
+    return retval;
+}
+
+// Check, via the metadata a and b of two series, that the
+// exponents of their product fit within the limits of the key type.
+// An overflow_error is raised only if the metadata of both
+// series is exact and the series are not empty, so that the
+// extremal exponents are attained by some term.
+template <typename T>
+inline void series_metadata_mul_check(const series_metadata<T> &a, bool a_empty, const series_metadata<T> &b,
+                                      bool b_empty)
+{
+    using key_t = typename T::key_type;
+    using exp_t = typename series_metadata<T>::exp_t;
+
+    if (!a.m_exact || !b.m_exact || a_empty || b_empty) {
+        return;
+    }
+
+    bool overflow = !series_metadata_mul(a, b);
+
+    if (!overflow) {
+        const auto ss = sym_union(a.m_ss, b.m_ss);
+
+        // The monomials formed by the minimum and maximum
+        // exponents of md in the merged symbol set.
+        auto make_keys = [&ss](const series_metadata<T> &md) {
+            ::std::vector<exp_t> lo, hi;
+            for (const auto &s : ss) {
+                const auto r = detail::metadata_exp_range(md, s);
+                lo.push_back(r.first);
+                hi.push_back(r.second);
+            }
+
+            return ::std::vector<key_t>{key_pack<key_t>(lo), key_pack<key_t>(hi)};
+        };
+
+        ::std::vector<key_t> a_keys, b_keys;
+        try {
+            a_keys = make_keys(a);
+            b_keys = make_keys(b);
+        } catch (...) {
+            // NOTE: the exponents do not fit in the merged
+            // symbol set, let the multiplication report the error.
+            return;
+        }
+
+        // NOTE: the check is performed against the limits
+        // of the monomial type (e.g., the packing limits).
+        overflow = !::obake::monomial_range_overflow_check(a_keys, b_keys, ss);
+    }
+
+    if (overflow) {
+        throw ::std::overflow_error("the exponents of the product of two polynomials would overflow");
+    }
+}
+
+namespace detail
+{
+
+// The cached metadata of the exposed series of type T, indexed by
+// the address of the series. The registry is accessed only with
+// the GIL held. The entry of a series is erased (via a weak reference)
+// when the Python object wrapping the series is destroyed.
+// NOTE: the registry is not accessible from Python, so that
+// the cached metadata cannot be tampered with.
+// NOTE: the registry is never destroyed, as the weak reference
+// callbacks may be invoked during interpreter shutdown.
+template <typename T>
+inline auto &metadata_registry()
+{
+    static auto *retval = new ::std::unordered_map<const T *, py::object>;
+
+    return *retval;
+}
+
+} // namespace detail
+
+// Fetch the cached metadata of x, if any.
+template <typename T>
+inline ::std::optional<series_metadata<T>> series_metadata_get(const T &x)
+{
+    auto &reg = detail::metadata_registry<T>();
+
+    const auto it = reg.find(&x);
+    if (it == reg.end() || !it->second) {
+        return {};
+    }
+
+    return it->second.template cast<series_metadata<T>>();
+}
+
+// Cache the metadata md for the series wrapped by the Python object o.
+template <typename T>
+inline void series_metadata_set(const py::object &o, py::object md)
+{
+    auto &reg = detail::metadata_registry<T>();
+    const auto *ptr = &o.template cast<const T &>();
+
+    const auto [it, new_entry] = reg.try_emplace(ptr);
+    if (new_entry) {
+        // Erase the entry when o is destroyed.
+        try {
+            py::weakref(o, py::cpp_function([ptr](py::handle wr) {
+                detail::metadata_registry<T>().erase(ptr);
+                wr.dec_ref();
+            }))
+                .release();
+        } catch (...) {
+            reg.erase(it);
+            throw;
+        }
+    }
+
+    it->second = ::std::move(md);
+}
+
+// Drop the cached metadata of x. This must be called
+// whenever x is modified in-place.
+template <typename T>
+inline void series_metadata_drop(const T &x)
+{
+    auto &reg = detail::metadata_registry<T>();
+
+    // NOTE: keep the entry, which is erased
+    // when the Python object is destroyed.
+    if (const auto it = reg.find(&x); it != reg.end()) {
+        it->second = py::object{};
+    }
+}
+
+// Wrap the result of a binary operation between x and y
+// into a Python object, propagating the cached
+// metadata via the function f. f returns an empty optional
+// if the metadata cannot be propagated.
+template <typename T, typename F>
+inline py::object series_metadata_propagate(T &&ret, const T &x, const T &y, const F &f)
+{
+    auto retval = py::cast(::std::move(ret));
+
+    if (auto mx = series_metadata_get(x)) {
+        if (auto my = series_metadata_get(y)) {
+            if (auto md = f(*mx, *my)) {
+                series_metadata_set<T>(retval, py::cast(::std::move(*md)));
+            }
+        }
+    }
+
+    return retval;
+}
+
+// Expose the metadata class for the series type T, and the
+// metadata property on the class of T.
+template <typename T, typename Class>
+inline void expose_series_metadata(py::module &m, Class &series_class)
+{
+    using md_t = series_metadata<T>;
+
+    py::class_<md_t> class_inst(m, ("_metadata_type_" + ::std::to_string(exposed_types_counter++)).c_str());
+
+    class_inst.def("__repr__", [](const md_t &md) {
+        return "Series metadata (" + ::std::string(md.m_exact ? "exact" : "bounds") + "), degree in ["
+               + py::str(py::cast(md.m_min_degree)).template cast<::std::string>() + ", "
+               + py::str(py::cast(md.m_max_degree)).template cast<::std::string>() + "]";
+    });
+    class_inst.def_readonly("exact", &md_t::m_exact);
+    class_inst.def_property_readonly(
+        "degree_bounds", [](const md_t &md) { return py::make_tuple(md.m_min_degree, md.m_max_degree); });
+    class_inst.def_property_readonly("exponent_bounds", [](const md_t &md) {
+        py::dict retval;
+
+        decltype(md.m_ss.size()) i = 0;
+        for (const auto &s : md.m_ss) {
+            retval[py::str(s)] = py::make_tuple(md.m_min_exps[i], md.m_max_exps[i]);
+            ++i;
+        }
+
+        return retval;
+    });
+    class_inst.def_property_readonly("symbol_set", [](const md_t &md) { return obake_ss_to_py_list(md.m_ss); });
+
+    // The metadata property. The metadata is
+    // computed on first access and then cached.
+    series_class.def_property_readonly("metadata", [](const py::object &self) {
+        const auto &x = self.cast<const T &>();
+
+        auto &reg = detail::metadata_registry<T>();
+        if (const auto it = reg.find(&x); it != reg.end() && it->second) {
+            return it->second;
+        }
+
+        md_t md;
+        {
+            py::gil_scoped_release release;
+
+            md = series_metadata_compute(x);
+        }
+
+        auto retval = py::cast(::std::move(md));
+        series_metadata_set<T>(self, retval);
+
+        return retval;
+    });
+}
+
+} // namespace obake_py
+
+#endif
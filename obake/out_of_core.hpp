@@ -0,0 +1,560 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_OUT_OF_CORE_HPP
+#define OBAKE_PY_OUT_OF_CORE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/hana/for_each.hpp>
+
+#include <obake/hash.hpp>
+#include <obake/math/evaluate.hpp>
+#include <obake/polynomials/monomial_mul.hpp>
+#include <obake/polynomials/monomial_range_overflow_check.hpp>
+#include <obake/s11n.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/blocked_range2d.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include "addmul.hpp"
+#include "estimate.hpp"
+#include "interrupt.hpp"
+#include "metadata.hpp"
+#include "power_cache.hpp"
+#include "sym_merge.hpp"
+#include "type_system.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace hana = ::boost::hana;
+namespace py = ::pybind11;
+
+// A series stored on disk as a set of partitions, each
+// partition being a series serialised in a separate file.
+// The partitions have the same symbol set and no keys
+// in common. The files are stored in a directory created
+// for the disk series. If the directory is temporary, it is
+// removed (together with the files) on destruction.
+template <typename T>
+struct disk_series {
+    ::std::string m_dir;
+    ::std::vector<::std::string> m_files;
+    ::std::vector<unsigned long long> m_sizes;
+    ::obake::symbol_set m_ss;
+    // Flag signalling that the files must be
+    // removed when the disk series is destroyed.
+    bool m_temporary = false;
+    bool m_removed = false;
+
+    disk_series() = default;
+    // NOTE: the files are owned by a single disk series,
+    // hence the class is move-only and a moved-from object
+    // is marked as removed.
+    disk_series(disk_series &&other)
+        : m_dir(::std::move(other.m_dir)), m_files(::std::move(other.m_files)),
+          m_sizes(::std::move(other.m_sizes)), m_ss(::std::move(other.m_ss)), m_temporary(other.m_temporary),
+          m_removed(other.m_removed)
+    {
+        other.m_removed = true;
+    }
+    disk_series(const disk_series &) = delete;
+    disk_series &operator=(const disk_series &) = delete;
+    disk_series &operator=(disk_series &&) = delete;
+    ~disk_series()
+    {
+        if (m_temporary) {
+            remove();
+        }
+    }
+
+    void check() const
+    {
+        if (m_removed) {
+            throw ::std::invalid_argument("the files of this disk polynomial have been removed");
+        }
+    }
+
+    T load(::std::size_t i) const
+    {
+        check();
+
+        ::std::ifstream ifs(m_files[i], ::std::ios::binary);
+        if (!ifs) {
+            throw ::std::runtime_error("cannot open the file '" + m_files[i] + "' for reading");
+        }
+
+        ::boost::archive::binary_iarchive ia(ifs);
+        T retval;
+        ia >> retval;
+
+        return retval;
+    }
+
+    void save(::std::size_t i, const T &x)
+    {
+        ::std::ofstream ofs(m_files[i], ::std::ios::binary | ::std::ios::trunc);
+        if (!ofs) {
+            throw ::std::runtime_error("cannot open the file '" + m_files[i] + "' for writing");
+        }
+
+        ::boost::archive::binary_oarchive oa(ofs);
+        oa << x;
+
+        m_sizes[i] = static_cast<unsigned long long>(x.size());
+    }
+
+    unsigned long long size() const
+    {
+        unsigned long long retval = 0;
+        for (auto s : m_sizes) {
+            retval += s;
+        }
+        return retval;
+    }
+
+    void remove()
+    {
+        if (m_removed) {
+            return;
+        }
+
+        for (const auto &f : m_files) {
+            ::std::remove(f.c_str());
+        }
+        // NOTE: this removes the directory
+        // if it is empty.
+        ::std::remove(m_dir.c_str());
+
+        m_removed = true;
+    }
+};
+
+// Iterator over the partitions of a disk series.
+template <typename T>
+struct disk_series_iterator {
+    py::object m_ds;
+    ::std::size_t m_idx = 0;
+};
+
+namespace detail
+{
+
+// Append x as a new run to the file f.
+template <typename T>
+inline void out_of_core_append_run(const ::std::string &f, const T &x)
+{
+    ::std::ofstream ofs(f, ::std::ios::binary | ::std::ios::app);
+    if (!ofs) {
+        throw ::std::runtime_error("cannot open the file '" + f + "' for writing");
+    }
+
+    ::boost::archive::binary_oarchive oa(ofs);
+    oa << x;
+}
+
+} // namespace detail
+
+// Out-of-core multiplication of a and b. The output is partitioned by
+// key hash into a number of partitions determined by an upper bound on
+// the size of the product and by the memory budget. The product is computed
+// in a single pass over the term pairs, in chunks whose size is limited by
+// the memory budget. The products of each chunk are computed in parallel
+// and then routed into in-memory per-partition buffers. When the buffers
+// exceed (roughly) half of the budget, each buffer is appended as a run
+// to a file of its partition. When all the products have been computed,
+// the runs of each partition are reduced and the result is saved into
+// the directory dir. The terms of degree greater than max_degree are never
+// computed, and the terms whose coefficient is smaller in absolute value
+// than min_abs_cf are discarded when the partitions are reduced.
+// The progress is reported into st, and the files written so far are
+// removed if the operation is cancelled (or fails).
+template <typename T>
+inline disk_series<T> mul_out_of_core(const T &a, const T &b, const ::std::string &dir, bool temporary,
+                                      unsigned long long budget, const ::std::optional<series_degree_t<T>> &max_degree,
+                                      const ::std::optional<double> &min_abs_cf, interrupt_state &st)
+{
+    using key_t = typename T::key_type;
+    using cf_t = typename T::cf_type;
+
+    if (budget == 0u) {
+        throw ::std::invalid_argument("the memory budget for an out-of-core multiplication must be nonzero");
+    }
+
+    // Bring the operands to a common symbol set.
+    const auto ss = sym_union(a.get_symbol_set(), b.get_symbol_set());
+
+    ::std::optional<T> a_ext, b_ext;
+    if (a.get_symbol_set() != ss) {
+        a_ext.emplace(a);
+        sym_extend(*a_ext, ss);
+    }
+    if (b.get_symbol_set() != ss) {
+        b_ext.emplace(b);
+        sym_extend(*b_ext, ss);
+    }
+    const auto &a_ref = a_ext ? *a_ext : a;
+    const auto &b_ref = b_ext ? *b_ext : b;
+
+    const auto [a_terms, a_degs] = detail::addmul_flatten(a_ref);
+    const auto [b_terms, b_degs] = detail::addmul_flatten(b_ref);
+
+    if (!a_terms.empty() && !b_terms.empty()) {
+        ::std::vector<key_t> a_keys, b_keys;
+        for (const auto &t : a_terms) {
+            a_keys.push_back(*t.first);
+        }
+        for (const auto &t : b_terms) {
+            b_keys.push_back(*t.first);
+        }
+
+        if (!::obake::monomial_range_overflow_check(a_keys, b_keys, ss)) {
+            throw ::std::overflow_error(
+                "an overflow in the monomial exponents was detected in an out-of-core multiplication");
+        }
+    }
+
+    // The number of term pairs (taking into account
+    // the truncation) for each term of a.
+    // NOTE: the terms are sorted by degree.
+    ::std::vector<decltype(b_terms.size())> n_cols(a_terms.size(), b_terms.size());
+    if (max_degree) {
+        for (decltype(a_terms.size()) i = 0; i < a_terms.size(); ++i) {
+            n_cols[i] = static_cast<decltype(b_terms.size())>(
+                ::std::partition_point(b_degs.begin(), b_degs.end(),
+                                       [&](const auto &d) { return !(*max_degree < a_degs[i] + d); })
+                - b_degs.begin());
+        }
+    }
+    unsigned long long n_pairs = 0;
+    for (auto n : n_cols) {
+        n_pairs += static_cast<unsigned long long>(n);
+    }
+
+    // NOTE: one unit of work per term pair.
+    st.m_total.store(n_pairs, ::std::memory_order_relaxed);
+
+    // Determine the number of partitions from an upper bound on the
+    // number of terms of the product: the number of term pairs and
+    // the number of monomials within the exponent ranges of the product.
+    // NOTE: the sampling-based estimate of the size of the product
+    // cannot be used here, as it is not an upper bound.
+    // NOTE: leave some room for the overhead of the hash tables.
+    double n_max = static_cast<double>(n_pairs);
+    if (n_pairs != 0u) {
+        if (const auto mp = series_metadata_mul(series_metadata_compute(a_ref), series_metadata_compute(b_ref))) {
+            double box = 1;
+            for (decltype(mp->m_min_exps.size()) i = 0; i < mp->m_min_exps.size(); ++i) {
+                box *= static_cast<double>(mp->m_max_exps[i]) - static_cast<double>(mp->m_min_exps[i]) + 1.;
+            }
+            n_max = ::std::min(n_max, box);
+        }
+    }
+    const auto term_bytes = estimate_term_byte_size(a_ref, b_ref);
+    const auto n_parts = static_cast<::std::size_t>(
+        ::std::clamp(::std::ceil(2. * n_max * term_bytes / static_cast<double>(budget)), 1., 65536.));
+
+    disk_series<T> retval;
+    retval.m_dir = dir;
+    retval.m_ss = ss;
+    retval.m_temporary = temporary;
+    retval.m_sizes.resize(n_parts);
+    ::std::vector<::std::string> run_files;
+    for (::std::size_t p = 0; p < n_parts; ++p) {
+        retval.m_files.push_back(dir + "/part_" + ::std::to_string(p) + ".bin");
+        run_files.push_back(dir + "/part_" + ::std::to_string(p) + ".runs");
+    }
+
+    // NOTE: never overwrite existing files. This check must be
+    // performed before any file is written, as the files are
+    // removed if the multiplication fails.
+    for (const auto &v : {&retval.m_files, &run_files}) {
+        for (const auto &f : *v) {
+            if (::std::ifstream(f)) {
+                retval.m_removed = true;
+                throw ::std::invalid_argument("the file '" + f
+                                              + "' already exists, the out-of-core multiplication cannot overwrite it");
+            }
+        }
+    }
+
+    // The maximum number of terms in the buffers. NOTE: the buffers
+    // use up to half of the budget (accounting for the overhead of the
+    // hash tables), the other half is needed to reduce a partition.
+    const auto max_buffered
+        = static_cast<unsigned long long>(::std::max(1., static_cast<double>(budget) / (4. * term_bytes)));
+
+    try {
+        // The per-partition buffers, and the number
+        // of runs appended to the file of each partition.
+        ::std::vector<T> bufs(n_parts);
+        for (auto &buf : bufs) {
+            buf.set_symbol_set(ss);
+        }
+        ::std::vector<unsigned long long> n_runs(n_parts);
+        unsigned long long n_buffered = 0;
+
+        if (n_pairs != 0u) {
+            // The chunks of term pairs are rectangles whose area is at most
+            // a fraction of the capacity of the buffers, as the products
+            // of a chunk are stored before being routed into the buffers.
+            const auto chunk_area = ::std::max(1ull, max_buffered / 4u);
+            const auto chunk_cols = static_cast<decltype(b_terms.size())>(
+                ::std::min(chunk_area, static_cast<unsigned long long>(b_terms.size())));
+            const auto chunk_rows = static_cast<decltype(a_terms.size())>(
+                ::std::max(1ull, chunk_area / static_cast<unsigned long long>(chunk_cols)));
+
+            // The products of the current chunk, as
+            // (partition index, key, coefficient) tuples.
+            ::tbb::enumerable_thread_specific<::std::vector<::std::tuple<::std::size_t, key_t, cf_t>>> chunk_prods;
+
+            for (decltype(b_terms.size()) j0 = 0; j0 < b_terms.size(); j0 += chunk_cols) {
+                const auto j1 = ::std::min(b_terms.size(), j0 + chunk_cols);
+
+                for (decltype(a_terms.size()) i0 = 0; i0 < a_terms.size(); i0 += chunk_rows) {
+                    // NOTE: the terms are sorted by degree.
+                    if (n_cols[i0] <= j0) {
+                        break;
+                    }
+
+                    const auto i1 = ::std::min(a_terms.size(), i0 + chunk_rows);
+
+                    ::tbb::parallel_for(
+                        ::tbb::blocked_range2d<decltype(a_terms.size()), decltype(b_terms.size())>(i0, i1, j0, j1),
+                        [&](const auto &r) {
+                            st.check();
+
+                            auto &prods = chunk_prods.local();
+                            key_t tmp_key(ss);
+
+                            for (auto i = r.rows().begin(); i != r.rows().end(); ++i) {
+                                const auto &[ak, ac] = a_terms[i];
+                                const auto j_end = ::std::min(r.cols().end(), n_cols[i]);
+
+                                for (auto j = r.cols().begin(); j < j_end; ++j) {
+                                    const auto &[bk, bc] = b_terms[j];
+
+                                    ::obake::monomial_mul(tmp_key, *ak, *bk, ss);
+                                    prods.emplace_back(static_cast<::std::size_t>(::obake::hash(tmp_key)) % n_parts,
+                                                       tmp_key, *ac * *bc);
+                                }
+
+                                if (j_end > r.cols().begin()) {
+                                    st.progress(j_end - r.cols().begin());
+                                }
+                            }
+                        });
+
+                    // Route the products into the buffers.
+                    for (auto &prods : chunk_prods) {
+                        st.check();
+
+                        for (auto &[p, k, c] : prods) {
+                            auto &buf = bufs[p];
+                            const auto old_size = static_cast<unsigned long long>(buf.size());
+                            buf.add_term(::std::move(k), ::std::move(c));
+                            n_buffered = n_buffered - old_size + static_cast<unsigned long long>(buf.size());
+                        }
+                        prods.clear();
+                    }
+
+                    // Append the buffers to the runs, if needed.
+                    if (n_buffered >= max_buffered) {
+                        for (::std::size_t p = 0; p < n_parts; ++p) {
+                            if (!bufs[p].empty()) {
+                                st.check();
+                                detail::out_of_core_append_run(run_files[p], bufs[p]);
+                                ++n_runs[p];
+                                bufs[p] = T{};
+                                bufs[p].set_symbol_set(ss);
+                            }
+                        }
+                        n_buffered = 0;
+                    }
+                }
+            }
+        }
+
+        // Reduce the runs of each partition, together with
+        // the content of its buffer, and save the result.
+        for (::std::size_t p = 0; p < n_parts; ++p) {
+            st.check();
+
+            auto part = ::std::move(bufs[p]);
+
+            if (n_runs[p] != 0u) {
+                ::std::ifstream ifs(run_files[p], ::std::ios::binary);
+                if (!ifs) {
+                    throw ::std::runtime_error("cannot open the file '" + run_files[p] + "' for reading");
+                }
+
+                for (unsigned long long r = 0; r < n_runs[p]; ++r) {
+                    ::boost::archive::binary_iarchive ia(ifs);
+                    T run;
+                    ia >> run;
+
+                    if (part.empty()) {
+                        part = ::std::move(run);
+                    } else {
+                        part += run;
+                    }
+                }
+
+                ifs.close();
+                ::std::remove(run_files[p].c_str());
+            }
+
+            if (min_abs_cf) {
+                T filtered;
+                filtered.set_symbol_set(ss);
+                for (const auto &t : ::std::as_const(part)) {
+                    using ::std::abs;
+                    if (!(static_cast<double>(abs(t.second)) < *min_abs_cf)) {
+                        filtered.add_term(t.first, t.second);
+                    }
+                }
+                part = ::std::move(filtered);
+            }
+
+            retval.save(p, part);
+        }
+    } catch (...) {
+        for (const auto &f : run_files) {
+            ::std::remove(f.c_str());
+        }
+        retval.remove();
+        throw;
+    }
+
+    return retval;
+}
+
+// Expose the disk series class and the out-of-core
+// multiplication for the series type T.
+template <typename T, typename Types>
+inline void expose_disk_series(py::module &m, const Types &interop_types)
+{
+    using ds_type = disk_series<T>;
+    using it_type = disk_series_iterator<T>;
+
+    py::class_<ds_type> class_inst(m, ("_disk_polynomial_type_" + ::std::to_string(exposed_types_counter++)).c_str());
+
+    class_inst.def("__repr__", [](const ds_type &ds) {
+        return "Disk polynomial with " + ::std::to_string(ds.m_files.size()) + " partition(s) in '" + ds.m_dir + "'"
+               + (ds.m_removed ? " (removed)" : "");
+    });
+    class_inst.def("__len__", [](const ds_type &ds) {
+        ds.check();
+        return ds.size();
+    });
+    class_inst.def_property_readonly("symbol_set", [](const ds_type &ds) { return obake_ss_to_py_list(ds.m_ss); });
+    class_inst.def_property_readonly("path", [](const ds_type &ds) { return ds.m_dir; });
+    class_inst.def_property_readonly("n_partitions", [](const ds_type &ds) { return ds.m_files.size(); });
+    class_inst.def("partition", [](const ds_type &ds, ::std::size_t i) {
+        if (i >= ds.m_files.size()) {
+            py_throw(::PyExc_IndexError, ("the partition index " + ::std::to_string(i)
+                                          + " is out of bounds for a disk polynomial with "
+                                          + ::std::to_string(ds.m_files.size()) + " partition(s)")
+                                             .c_str());
+        }
+
+        py::gil_scoped_release release;
+
+        return ds.load(i);
+    });
+    class_inst.def("to_polynomial", [](const ds_type &ds) {
+        py::gil_scoped_release release;
+
+        T retval;
+        retval.set_symbol_set(ds.m_ss);
+        for (::std::size_t i = 0; i < ds.m_files.size(); ++i) {
+            retval += ds.load(i);
+        }
+
+        return retval;
+    });
+    class_inst.def("remove", [](ds_type &ds) { ds.remove(); });
+
+    // Streaming iteration over the partitions.
+    py::class_<it_type> it_inst(
+        m, ("_disk_polynomial_iterator_type_" + ::std::to_string(exposed_types_counter++)).c_str());
+    it_inst.def("__iter__", [](const py::object &self) { return self; });
+    it_inst.def("__next__", [](it_type &it) {
+        const auto &ds = it.m_ds.template cast<const ds_type &>();
+        if (it.m_idx == ds.m_files.size()) {
+            throw py::stop_iteration();
+        }
+
+        py::gil_scoped_release release;
+
+        return ds.load(it.m_idx++);
+    });
+    class_inst.def("__iter__", [](const py::object &self) { return it_type{self, 0}; });
+
+    // Truncation.
+    m.def("truncate_degree", [](ds_type &ds, const series_degree_t<T> &n) {
+        ds.check();
+
+        py::gil_scoped_release release;
+
+        for (::std::size_t i = 0; i < ds.m_files.size(); ++i) {
+            auto part = ds.load(i);
+            truncate_degree_in_place(part, n);
+            ds.save(i, part);
+        }
+    });
+
+    // Evaluation.
+    hana::for_each(interop_types, [&m](auto t) {
+        using cur_t = typename decltype(t)::type;
+
+        m.def("_evaluate", [](const cur_t &, const ds_type &ds, const py::dict &d) {
+            const auto sm = py_dict_to_obake_sm<cur_t>(d);
+
+            py::gil_scoped_release release;
+
+            decltype(::obake::evaluate(::std::declval<const T &>(), sm)) retval(0);
+            for (::std::size_t i = 0; i < ds.m_files.size(); ++i) {
+                retval += ::obake::evaluate(ds.load(i), sm);
+            }
+
+            return retval;
+        });
+    });
+
+    // Out-of-core multiplication.
+    m.def("_mul_out_of_core", [](const T &a, const T &b, const ::std::string &dir, bool temporary,
+                                 unsigned long long budget, const py::object &max_degree, const py::object &min_abs_cf) {
+        const auto md = py_object_to_opt_degree<T>(max_degree);
+        const auto mac = min_abs_cf.is_none() ? ::std::optional<double>{} : min_abs_cf.cast<double>();
+
+        return run_interruptible("mul_out_of_core", interrupt_mul_work(a, b), [&](interrupt_state &st) {
+            return mul_out_of_core(a, b, dir, temporary, budget, md, mac, st);
+        });
+    });
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,408 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_POLY_MATRIX_HPP
+#define OBAKE_PY_POLY_MATRIX_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/hana/for_each.hpp>
+
+#include <obake/math/evaluate.hpp>
+#include <obake/symbols.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "addmul.hpp"
+#include "estimate.hpp"
+#include "memory_budget.hpp"
+#include "sym_merge.hpp"
+#include "type_system.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace hana = ::boost::hana;
+namespace py = ::pybind11;
+
+// A dense matrix of series, stored in row-major
+// order. All the entries share the same symbol set.
+template <typename T>
+struct poly_matrix {
+    using size_type = ::std::size_t;
+
+    size_type m_rows = 0, m_cols = 0;
+    ::obake::symbol_set m_ss;
+    ::std::vector<T> m_data;
+
+    T &operator()(size_type i, size_type j)
+    {
+        return m_data[i * m_cols + j];
+    }
+    const T &operator()(size_type i, size_type j) const
+    {
+        return m_data[i * m_cols + j];
+    }
+};
+
+// Extend in parallel the symbol set of the entries of the matrix m to ss.
+template <typename T>
+inline void poly_matrix_extend(poly_matrix<T> &m, const ::obake::symbol_set &ss)
+{
+    if (m.m_ss == ss) {
+        return;
+    }
+
+    ::tbb::parallel_for(::tbb::blocked_range<decltype(m.m_data.size())>(0, m.m_data.size()), [&m, &ss](const auto &r) {
+        for (auto i = r.begin(); i != r.end(); ++i) {
+            sym_extend(m.m_data[i], ss);
+        }
+    });
+
+    m.m_ss = ss;
+}
+
+// Product of two matrices. The entries of the result
+// are computed in parallel, accumulating the products
+// via fused multiply-adds.
+template <typename T>
+inline poly_matrix<T> poly_matrix_mul(const poly_matrix<T> &a, const poly_matrix<T> &b)
+{
+    if (a.m_cols != b.m_rows) {
+        throw ::std::invalid_argument("cannot multiply a polynomial matrix with " + ::std::to_string(a.m_cols)
+                                      + " column(s) by a polynomial matrix with " + ::std::to_string(b.m_rows)
+                                      + " row(s)");
+    }
+
+    // Bring the operands to a common symbol set, if needed.
+    // NOTE: the copies are needed only in case of a mismatch.
+    const auto ss = sym_union(a.m_ss, b.m_ss);
+    poly_matrix<T> a_ext, b_ext;
+    const auto *pa = &a, *pb = &b;
+    if (a.m_ss != ss) {
+        a_ext = a;
+        poly_matrix_extend(a_ext, ss);
+        pa = &a_ext;
+    }
+    if (b.m_ss != ss) {
+        b_ext = b;
+        poly_matrix_extend(b_ext, ss);
+        pb = &b_ext;
+    }
+
+    // The memory budget check. The size of an entry of the result is
+    // estimated as the sum of the sizes of the products accumulated into it.
+    memory_budget_check(
+        [pa, pb]() {
+            const auto n_rows = pa->m_rows, n_cols = pb->m_cols;
+
+            ::std::vector<::std::pair<unsigned long long, double>> ests(n_rows * n_cols);
+            ::tbb::parallel_for(::tbb::blocked_range<decltype(ests.size())>(0, ests.size()),
+                                [pa, pb, n_cols, &ests](const auto &r) {
+                                    for (auto idx = r.begin(); idx != r.end(); ++idx) {
+                                        const auto i = idx / n_cols, j = idx % n_cols;
+
+                                        for (decltype(pa->m_cols) k = 0; k < pa->m_cols; ++k) {
+                                            const auto e = estimate_product((*pa)(i, k), (*pb)(k, j));
+                                            ests[idx].first += e.first;
+                                            ests[idx].second += e.second;
+                                        }
+                                    }
+                                });
+
+            ::std::pair<unsigned long long, double> retval{0, 0.};
+            for (const auto &e : ests) {
+                retval.first += e.first;
+                retval.second += e.second;
+            }
+
+            return retval;
+        },
+        "matmul");
+
+    poly_matrix<T> retval;
+    retval.m_rows = a.m_rows;
+    retval.m_cols = b.m_cols;
+    retval.m_ss = ss;
+    retval.m_data.resize(retval.m_rows * retval.m_cols);
+
+    ::tbb::parallel_for(::tbb::blocked_range<decltype(retval.m_data.size())>(0, retval.m_data.size()),
+                        [pa, pb, &retval](const auto &r) {
+                            for (auto idx = r.begin(); idx != r.end(); ++idx) {
+                                const auto i = idx / retval.m_cols, j = idx % retval.m_cols;
+
+                                auto &acc = retval.m_data[idx];
+                                acc.set_symbol_set(retval.m_ss);
+
+                                for (decltype(pa->m_cols) k = 0; k < pa->m_cols; ++k) {
+                                    series_addmul<true>(acc, (*pa)(i, k), (*pb)(k, j), {});
+                                }
+                            }
+                        });
+
+    return retval;
+}
+
+// Transpose of a matrix.
+template <typename T>
+inline poly_matrix<T> poly_matrix_transpose(const poly_matrix<T> &a)
+{
+    poly_matrix<T> retval;
+    retval.m_rows = a.m_cols;
+    retval.m_cols = a.m_rows;
+    retval.m_ss = a.m_ss;
+    retval.m_data.reserve(a.m_data.size());
+
+    for (decltype(a.m_cols) j = 0; j < a.m_cols; ++j) {
+        for (decltype(a.m_rows) i = 0; i < a.m_rows; ++i) {
+            retval.m_data.push_back(a(i, j));
+        }
+    }
+
+    return retval;
+}
+
+// Build a matrix from a list of rows.
+template <typename T>
+inline poly_matrix<T> py_list_to_poly_matrix(const py::list &rows)
+{
+    poly_matrix<T> retval;
+    retval.m_rows = py::len(rows);
+
+    for (const auto &row : rows) {
+        const auto r = row.cast<py::list>();
+
+        if (retval.m_data.empty()) {
+            retval.m_cols = py::len(r);
+        } else if (py::len(r) != retval.m_cols) {
+            py_throw(::PyExc_ValueError, ("all the rows of a polynomial matrix must have the same size, but rows of "
+                                          "size "
+                                          + ::std::to_string(retval.m_cols) + " and " + ::std::to_string(py::len(r))
+                                          + " were encountered instead")
+                                             .c_str());
+        }
+
+        if (retval.m_cols == 0u) {
+            py_throw(::PyExc_ValueError, "the rows of a polynomial matrix cannot be empty");
+        }
+
+        for (const auto &o : r) {
+            retval.m_data.push_back(o.cast<const T &>());
+            retval.m_ss = sym_union(retval.m_ss, retval.m_data.back().get_symbol_set());
+        }
+    }
+
+    ::tbb::parallel_for(::tbb::blocked_range<decltype(retval.m_data.size())>(0, retval.m_data.size()),
+                        [&retval](const auto &r) {
+                            for (auto i = r.begin(); i != r.end(); ++i) {
+                                sym_extend(retval.m_data[i], retval.m_ss);
+                            }
+                        });
+
+    return retval;
+}
+
+// Fetch and check the indices of an entry of a.
+template <typename T>
+inline ::std::pair<::std::size_t, ::std::size_t> poly_matrix_index(const poly_matrix<T> &a, const py::tuple &idx)
+{
+    if (py::len(idx) != 2u) {
+        py_throw(::PyExc_IndexError, "a polynomial matrix must be indexed by a pair of integers");
+    }
+
+    const auto i = idx[0].cast<long long>(), j = idx[1].cast<long long>();
+    const auto rows = static_cast<long long>(a.m_rows), cols = static_cast<long long>(a.m_cols);
+
+    // NOTE: support negative indices, as
+    // Python sequences do.
+    const auto ii = i < 0 ? i + rows : i, jj = j < 0 ? j + cols : j;
+
+    if (ii < 0 || ii >= rows || jj < 0 || jj >= cols) {
+        py_throw(::PyExc_IndexError, ("the index (" + ::std::to_string(i) + ", " + ::std::to_string(j)
+                                      + ") is out of bounds for a polynomial matrix of shape ("
+                                      + ::std::to_string(a.m_rows) + ", " + ::std::to_string(a.m_cols) + ")")
+                                         .c_str());
+    }
+
+    return {static_cast<::std::size_t>(ii), static_cast<::std::size_t>(jj)};
+}
+
+// Expose the matrix class for the series type T.
+template <typename T, typename Types>
+inline void expose_poly_matrix(py::module &m, const Types &interop_types)
+{
+    using pm_type = poly_matrix<T>;
+
+    py::class_<pm_type> class_inst(m, ("_poly_matrix_type_" + ::std::to_string(exposed_types_counter++)).c_str());
+
+    class_inst.def("__repr__", [](const pm_type &a) {
+        ::std::string retval = "Polynomial matrix of shape (" + ::std::to_string(a.m_rows) + ", "
+                               + ::std::to_string(a.m_cols) + ")\n[";
+        for (decltype(a.m_rows) i = 0; i < a.m_rows; ++i) {
+            retval += (i == 0u ? "[" : " [");
+            for (decltype(a.m_cols) j = 0; j < a.m_cols; ++j) {
+                retval += repr_ostr(a(i, j));
+                retval += (j + 1u == a.m_cols ? "]" : ", ");
+            }
+            retval += (i + 1u == a.m_rows ? "]" : "\n");
+        }
+        return retval;
+    });
+    class_inst.def("__copy__", &generic_copy_wrapper<pm_type>);
+    class_inst.def("__deepcopy__", &generic_deepcopy_wrapper<pm_type>);
+
+    // Accessors.
+    class_inst.def_property_readonly("shape", [](const pm_type &a) { return py::make_tuple(a.m_rows, a.m_cols); });
+    class_inst.def_property_readonly("symbol_set", [](const pm_type &a) { return obake_ss_to_py_list(a.m_ss); });
+    class_inst.def("__getitem__", [](const pm_type &a, const py::tuple &idx) {
+        const auto [i, j] = poly_matrix_index(a, idx);
+        return a(i, j);
+    });
+    class_inst.def("__setitem__", [](pm_type &a, const py::tuple &idx, const T &x) {
+        const auto [i, j] = poly_matrix_index(a, idx);
+
+        auto tmp(x);
+        const auto ss = sym_union(a.m_ss, tmp.get_symbol_set());
+
+        py::gil_scoped_release release;
+
+        poly_matrix_extend(a, ss);
+        sym_extend(tmp, ss);
+        a(i, j) = ::std::move(tmp);
+    });
+    class_inst.def("tolist", [](const pm_type &a) {
+        py::list retval;
+        for (decltype(a.m_rows) i = 0; i < a.m_rows; ++i) {
+            py::list row;
+            for (decltype(a.m_cols) j = 0; j < a.m_cols; ++j) {
+                row.append(py::cast(a(i, j)));
+            }
+            retval.append(row);
+        }
+        return retval;
+    });
+
+    // Comparison.
+    class_inst.def(
+        "__eq__",
+        [](const pm_type &a, const pm_type &b) {
+            return a.m_rows == b.m_rows && a.m_cols == b.m_cols && a.m_data == b.m_data;
+        },
+        py::is_operator());
+    class_inst.def(
+        "__ne__",
+        [](const pm_type &a, const pm_type &b) {
+            return !(a.m_rows == b.m_rows && a.m_cols == b.m_cols && a.m_data == b.m_data);
+        },
+        py::is_operator());
+
+    // Transpose.
+    class_inst.def("transpose", [](const pm_type &a) { return poly_matrix_transpose(a); });
+
+    // Matrix-matrix and matrix-vector products.
+    class_inst.def(
+        "__matmul__",
+        [](const pm_type &a, const pm_type &b) {
+            py::gil_scoped_release release;
+
+            return poly_matrix_mul(a, b);
+        },
+        py::is_operator());
+    class_inst.def(
+        "__matmul__",
+        [](const pm_type &a, const py::list &v) {
+            // Turn v into a column vector.
+            pm_type b;
+            b.m_rows = py::len(v);
+            b.m_cols = 1;
+            for (const auto &o : v) {
+                b.m_data.push_back(o.cast<const T &>());
+                b.m_ss = sym_union(b.m_ss, b.m_data.back().get_symbol_set());
+            }
+
+            pm_type res;
+            {
+                py::gil_scoped_release release;
+
+                for (auto &p : b.m_data) {
+                    sym_extend(p, b.m_ss);
+                }
+
+                res = poly_matrix_mul(a, b);
+            }
+
+            py::list retval;
+            for (auto &p : res.m_data) {
+                retval.append(py::cast(::std::move(p)));
+            }
+
+            return retval;
+        },
+        py::is_operator());
+
+    // Elementwise truncation.
+    using deg_t = series_degree_t<T>;
+    m.def("truncate_degree", [](pm_type &a, const deg_t &n) {
+        py::gil_scoped_release release;
+
+        ::tbb::parallel_for(::tbb::blocked_range<decltype(a.m_data.size())>(0, a.m_data.size()),
+                            [&a, &n](const auto &r) {
+                                for (auto i = r.begin(); i != r.end(); ++i) {
+                                    truncate_degree_in_place(a.m_data[i], n);
+                                }
+                            });
+    });
+
+    // Evaluation to a NumPy array.
+    hana::for_each(interop_types, [&m](auto t) {
+        using cur_t = typename decltype(t)::type;
+
+        m.def("_evaluate", [](const cur_t &, const pm_type &a, const py::dict &d) {
+            const auto sm = py_dict_to_obake_sm<cur_t>(d);
+
+            ::std::vector<decltype(::obake::evaluate(a.m_data[0], sm))> res(a.m_data.size());
+
+            {
+                py::gil_scoped_release release;
+
+                ::tbb::parallel_for(::tbb::blocked_range<decltype(a.m_data.size())>(0, a.m_data.size()),
+                                    [&a, &sm, &res](const auto &r) {
+                                        for (auto i = r.begin(); i != r.end(); ++i) {
+                                            res[i] = ::obake::evaluate(a.m_data[i], sm);
+                                        }
+                                    });
+            }
+
+            py::list rows;
+            for (decltype(a.m_rows) i = 0; i < a.m_rows; ++i) {
+                py::list row;
+                for (decltype(a.m_cols) j = 0; j < a.m_cols; ++j) {
+                    row.append(py::cast(::std::move(res[i * a.m_cols + j])));
+                }
+                rows.append(row);
+            }
+
+            return py::module::import("numpy").attr("array")(rows);
+        });
+    });
+
+    // Factory function.
+    m.def("_poly_matrix", [](const T &, const py::list &rows) { return py_list_to_poly_matrix<T>(rows); });
+}
+
+} // namespace obake_py
+
+#endif
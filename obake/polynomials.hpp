@@ -9,9 +9,12 @@
 #ifndef OBAKE_PY_POLYNOMIALS_HPP
 #define OBAKE_PY_POLYNOMIALS_HPP
 
+#include <algorithm>
 #include <iterator>
+#include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <boost/hana/for_each.hpp>
 #include <boost/hana/tuple.hpp>
@@ -56,7 +59,27 @@
 #include <pybind11/operators.h>
 #include <pybind11/pybind11.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "addmul.hpp"
+#include "async.hpp"
+#include "converters.hpp"
+#include "dense_mul.hpp"
 #include "docstrings.hpp"
+#include "estimate.hpp"
+#include "evaluate_many.hpp"
+#include "frozen.hpp"
+#include "interrupt.hpp"
+#include "memory_budget.hpp"
+#include "metadata.hpp"
+#include "out_of_core.hpp"
+#include "poly_matrix.hpp"
+#include "power_cache.hpp"
+#include "series_table.hpp"
+#include "shared_polynomial.hpp"
+#include "specialize.hpp"
+#include "sym_merge.hpp"
 #include "type_system.hpp"
 #include "utils.hpp"
 
@@ -117,28 +140,233 @@ inline void expose_polynomial(py::module &m, type_getter &tg)
     // Table stats.
     class_inst.def("table_stats", &p_type::table_stats);
 
+    // Table capacity and segmentation.
+    class_inst.def("reserve", [](p_type &p, unsigned long long n) { series_reserve(p, n); });
+    class_inst.def("shrink_to_fit", [](p_type &p) { series_shrink_to_fit(p); });
+    class_inst.def("set_n_segments", [](p_type &p, unsigned l) { series_set_n_segments(p, l); });
+    class_inst.def("get_n_segments", [](const p_type &p) { return p.get_s_size(); });
+    class_inst.def("get_capacity", [](const p_type &p) { return series_capacity(p); });
+
     // Symbol set getter.
     class_inst.def_property_readonly(
         "symbol_set", [](const p_type &p) { return obake_ss_to_py_list(p.get_symbol_set()); },
         symbol_set_docstring().c_str());
 
+    // Cached metadata.
+    expose_series_metadata<p_type>(m, class_inst);
+
     // Arithmetics vs self.
+    // NOTE: the binary operators are implemented
+    // via lambdas in order to keep track of the
+    // symbol merges and of the cached metadata.
     class_inst.def(+py::self);
-    class_inst.def(py::self + py::self);
-    class_inst.def(py::self += py::self);
-    class_inst.def(-py::self);
-    class_inst.def(py::self - py::self);
-    class_inst.def(py::self -= py::self);
-    class_inst.def(py::self * py::self);
-    class_inst.def(py::self *= py::self);
+    class_inst.def(
+        "__add__",
+        [](const p_type &a, const p_type &b) {
+            sym_merge_check(sym_merge_op::add, a, b);
+            return series_metadata_propagate(a + b, a, b, &series_metadata_add<p_type>);
+        },
+        py::is_operator());
+    class_inst.def(
+        "__iadd__",
+        [](p_type &a, const p_type &b) -> p_type & {
+            sym_merge_check(sym_merge_op::add, a, b);
+            series_metadata_drop(a);
+            return a += b;
+        },
+        py::is_operator());
+    class_inst.def(
+        "__neg__",
+        [](const p_type &a) {
+            auto retval = py::cast(-a);
+            if (auto md = series_metadata_get(a)) {
+                series_metadata_set<p_type>(retval, py::cast(::std::move(*md)));
+            }
+            return retval;
+        },
+        py::is_operator());
+    class_inst.def(
+        "__sub__",
+        [](const p_type &a, const p_type &b) {
+            sym_merge_check(sym_merge_op::sub, a, b);
+            return series_metadata_propagate(a - b, a, b, &series_metadata_add<p_type>);
+        },
+        py::is_operator());
+    class_inst.def(
+        "__isub__",
+        [](p_type &a, const p_type &b) -> p_type & {
+            sym_merge_check(sym_merge_op::sub, a, b);
+            series_metadata_drop(a);
+            return a -= b;
+        },
+        py::is_operator());
+    class_inst.def(
+        "__mul__",
+        [](const p_type &a, const p_type &b) {
+            sym_merge_check(sym_merge_op::mul, a, b);
+            // Quick overflow check via the cached metadata.
+            if (auto ma = series_metadata_get(a), mb = series_metadata_get(b); ma && mb) {
+                series_metadata_mul_check(*ma, a.empty(), *mb, b.empty());
+            }
+            auto ret = run_interruptible("mul", interrupt_mul_work(a, b), [&a, &b](interrupt_state &) {
+                memory_budget_check([&a, &b]() { return estimate_product(a, b); }, "mul");
+
+                return a * b;
+            });
+            return series_metadata_propagate(::std::move(ret), a, b, &series_metadata_mul<p_type>);
+        },
+        py::is_operator());
+    class_inst.def(
+        "__imul__",
+        [](p_type &a, const p_type &b) -> p_type & {
+            sym_merge_check(sym_merge_op::mul, a, b);
+            // Quick overflow check via the cached metadata.
+            if (auto ma = series_metadata_get(a), mb = series_metadata_get(b); ma && mb) {
+                series_metadata_mul_check(*ma, a.empty(), *mb, b.empty());
+            }
+            // NOTE: a is left untouched if
+            // the product is interrupted.
+            auto ret = run_interruptible("mul", interrupt_mul_work(a, b), [&a, &b](interrupt_state &) {
+                memory_budget_check([&a, &b]() { return estimate_product(a, b); }, "mul");
+
+                return a * b;
+            });
+            series_metadata_drop(a);
+            // NOTE: the product is computed into a new table,
+            // preserve the segmentation and the capacity of a if they
+            // are larger than those of the product.
+            const auto l = a.get_s_size();
+            const auto bcs = series_bucket_counts(a);
+            a = ::std::move(ret);
+            if (a.get_s_size() < l) {
+                series_set_n_segments(a, l);
+            }
+            series_restore_bucket_counts(a, bcs);
+            return a;
+        },
+        py::is_operator());
+
+    // Fused multiply-accumulate.
+    class_inst.def(
+        "addmul",
+        [](p_type &acc, const p_type &a, const p_type &b, const py::object &max_degree) {
+            const auto md = py_object_to_opt_degree<p_type>(max_degree);
+            series_metadata_drop(acc);
+
+            py::gil_scoped_release release;
+
+            series_addmul<true>(acc, a, b, md);
+        },
+        py::arg("a"), py::arg("b"), py::arg("max_degree") = py::none());
+    class_inst.def(
+        "submul",
+        [](p_type &acc, const p_type &a, const p_type &b, const py::object &max_degree) {
+            const auto md = py_object_to_opt_degree<p_type>(max_degree);
+            series_metadata_drop(acc);
+
+            py::gil_scoped_release release;
+
+            series_addmul<false>(acc, a, b, md);
+        },
+        py::arg("a"), py::arg("b"), py::arg("max_degree") = py::none());
 
     // Comparison vs self.
     class_inst.def(py::self == py::self);
     class_inst.def(py::self != py::self);
 
+    // Bulk symbol set alignment.
+    m.def("_align", [](const p_type &, const py::list &l, const py::object &ss) {
+        // Fetch pointers to the polynomials in l. Duplicates
+        // are removed so that each polynomial is
+        // extended only once.
+        ::std::vector<p_type *> v;
+        v.reserve(l.size());
+        for (const auto &o : l) {
+            v.push_back(&o.cast<p_type &>());
+            series_metadata_drop(*v.back());
+        }
+        ::std::sort(v.begin(), v.end());
+        v.erase(::std::unique(v.begin(), v.end()), v.end());
+
+        // Determine the target symbol set.
+        ::obake::symbol_set target;
+        if (ss.is_none()) {
+            for (const auto *p : v) {
+                target = sym_union(target, p->get_symbol_set());
+            }
+        } else {
+            target = py_object_to_obake_ss(ss);
+            // NOTE: check all the polynomials before
+            // starting to modify them.
+            for (const auto *p : v) {
+                sym_extend_check(*p, target);
+            }
+        }
+
+        {
+            py::gil_scoped_release release;
+
+            ::tbb::parallel_for(::tbb::blocked_range<decltype(v.size())>(0, v.size()), [&v, &target](const auto &r) {
+                for (auto i = r.begin(); i != r.end(); ++i) {
+                    sym_extend(*v[i], target);
+                }
+            });
+        }
+
+        return obake_ss_to_py_list(target);
+    });
+
     // Substitution with self.
     m.def("_subs", [](const p_type &, const p_type &x, const py::dict &d) {
-        return ::obake::subs(x, py_dict_to_obake_sm<p_type>(d));
+        const auto sm = py_dict_to_obake_sm<p_type>(d);
+
+        return run_interruptible("subs", interrupt_subs_work(x, sm), [&x, &sm](interrupt_state &) {
+            memory_budget_check([&x, &sm]() { return estimate_subs(x, sm); }, "subs");
+
+            return ::obake::subs(x, sm);
+        });
+    });
+
+    // Product size estimation.
+    m.def("estimate_product", [](const p_type &a, const p_type &b) {
+        ::std::pair<unsigned long long, double> retval;
+        {
+            py::gil_scoped_release release;
+
+            retval = estimate_product(a, b);
+        }
+
+        return py::make_tuple(retval.first, retval.second);
+    });
+
+    // Multiplication with a selectable method.
+    m.def("_mul", [](const p_type &a, const p_type &b, const ::std::string &method) {
+        const auto mm = str_to_mul_method(method);
+        sym_merge_check(sym_merge_op::mul, a, b);
+
+        return run_interruptible("mul", interrupt_mul_work(a, b), [&a, &b, mm](interrupt_state &) {
+            memory_budget_check([&a, &b]() { return estimate_product(a, b); }, "mul");
+
+            return mul_with_method(a, b, mm);
+        });
+    });
+
+    // Asynchronous multiplication and substitution with self.
+    // NOTE: the input arguments are copied at submission, so
+    // that they can be modified while the computation is running.
+    m.def("_mul_async", [](const p_type &a, const p_type &b, const py::object &fut) {
+        async_submit(fut, [a, b]() {
+            memory_budget_check([&a, &b]() { return estimate_product(a, b); }, "mul");
+
+            return a * b;
+        });
+    });
+    m.def("_subs_async", [](const p_type &, const p_type &x, const py::dict &d, const py::object &fut) {
+        async_submit(fut, [x, sm = py_dict_to_obake_sm<p_type>(d)]() {
+            memory_budget_check([&x, &sm]() { return estimate_subs(x, sm); }, "subs");
+
+            return ::obake::subs(x, sm);
+        });
     });
 
     // Interact with the interoperable types.
@@ -156,18 +384,42 @@ inline void expose_polynomial(py::module &m, type_getter &tg)
         // Arithmetics.
         class_inst.def(py::self + cur_t{});
         class_inst.def(cur_t{} + py::self);
-        class_inst.def(py::self += cur_t{});
+        class_inst.def(
+            "__iadd__",
+            [](p_type &a, const cur_t &x) -> p_type & {
+                series_metadata_drop(a);
+                return a += x;
+            },
+            py::is_operator());
 
         class_inst.def(py::self - cur_t{});
         class_inst.def(cur_t{} - py::self);
-        class_inst.def(py::self -= cur_t{});
+        class_inst.def(
+            "__isub__",
+            [](p_type &a, const cur_t &x) -> p_type & {
+                series_metadata_drop(a);
+                return a -= x;
+            },
+            py::is_operator());
 
         class_inst.def(py::self * cur_t{});
         class_inst.def(cur_t{} * py::self);
-        class_inst.def(py::self *= cur_t{});
+        class_inst.def(
+            "__imul__",
+            [](p_type &a, const cur_t &x) -> p_type & {
+                series_metadata_drop(a);
+                return a *= x;
+            },
+            py::is_operator());
 
         class_inst.def(py::self / cur_t{});
-        class_inst.def(py::self /= cur_t{});
+        class_inst.def(
+            "__itruediv__",
+            [](p_type &a, const cur_t &x) -> p_type & {
+                series_metadata_drop(a);
+                return a /= x;
+            },
+            py::is_operator());
 
         // Comparisons.
         class_inst.def(py::self == cur_t{});
@@ -176,17 +428,113 @@ inline void expose_polynomial(py::module &m, type_getter &tg)
         class_inst.def(cur_t{} != py::self);
 
         // Exponentiation.
-        class_inst.def("__pow__", [](const p_type &p, const cur_t &x) { return ::obake::pow(p, x); });
+        // NOTE: the memory budget is checked only
+        // for integral exponents.
+        const auto pow_estimate = [](const p_type &p, const cur_t &x) {
+            const auto n = estimate_pow_exponent(x);
+            return n ? estimate_pow(p, *n) : ::std::pair<unsigned long long, double>{0, 0.};
+        };
+        class_inst.def("__pow__", [pow_estimate](const p_type &p, const cur_t &x) {
+            return run_interruptible("pow", interrupt_pow_work(p, estimate_pow_exponent(x)), [&](interrupt_state &) {
+                memory_budget_check([&]() { return pow_estimate(p, x); }, "pow");
+
+                return ::obake::pow(p, x);
+            });
+        });
+        m.def("_pow_async", [pow_estimate](const p_type &p, const cur_t &x, const py::object &fut) {
+            async_submit(fut, [p, x, pow_estimate]() {
+                memory_budget_check([&]() { return pow_estimate(p, x); }, "pow");
+
+                return ::obake::pow(p, x);
+            });
+        });
 
         // Subs.
-        m.def("_subs", [](const cur_t &, const p_type &x, const py::dict &d) {
-            return ::obake::subs(x, py_dict_to_obake_sm<cur_t>(d));
+        // NOTE: the substitution of symbols with values
+        // cannot increase the number of terms.
+        const auto subs_estimate
+            = [](const p_type &x) { return ::std::make_pair(x.size(), x.size() * estimate_term_byte_size(x, x)); };
+        m.def("_subs", [subs_estimate](const cur_t &, const p_type &x, const py::dict &d) {
+            const auto sm = py_dict_to_obake_sm<cur_t>(d);
+
+            return run_interruptible("subs", interrupt_subs_work(x, sm), [&](interrupt_state &) {
+                memory_budget_check([&]() { return subs_estimate(x); }, "subs");
+
+                return ::obake::subs(x, sm);
+            });
+        });
+        m.def("_subs_async", [subs_estimate](const cur_t &, const p_type &x, const py::dict &d, const py::object &fut) {
+            async_submit(fut, [x, sm = py_dict_to_obake_sm<cur_t>(d), subs_estimate]() {
+                memory_budget_check([&]() { return subs_estimate(x); }, "subs");
+
+                return ::obake::subs(x, sm);
+            });
         });
 
         // Evaluate.
         m.def("_evaluate", [](const cur_t &, const p_type &x, const py::dict &d) {
             return ::obake::evaluate(x, py_dict_to_obake_sm<cur_t>(d));
         });
+
+        // Batched evaluation.
+        m.def("_evaluate_many", [](const cur_t &, const p_type &, const py::list &l, const py::dict &d) {
+            const auto sm = py_dict_to_obake_sm<cur_t>(d);
+
+            ::std::vector<const p_type *> v;
+            for (const auto &o : l) {
+                v.push_back(&o.cast<const p_type &>());
+            }
+
+            ::std::vector<decltype(::obake::evaluate(*v[0], sm))> res;
+            {
+                py::gil_scoped_release release;
+
+                res = evaluate_many(v, sm);
+            }
+
+            py::list retval;
+            for (auto &r : res) {
+                retval.append(py::cast(::std::move(r)));
+            }
+
+            return retval;
+        });
+
+        // Partial evaluation.
+        m.def("_specialize", [](const cur_t &, const p_type &x, const py::dict &d) {
+            const auto sm = py_dict_to_obake_sm<cur_t>(d);
+
+            py::gil_scoped_release release;
+
+            return specialize(x, sm);
+        });
+        m.def("_specialize_many", [](const cur_t &, const p_type &x, const py::list &l) {
+            ::std::vector<::obake::symbol_map<cur_t>> sms;
+            sms.reserve(l.size());
+            for (const auto &o : l) {
+                sms.push_back(py_dict_to_obake_sm<cur_t>(o.cast<py::dict>()));
+            }
+
+            ::std::vector<decltype(specialize(x, sms[0]))> res(sms.size());
+
+            {
+                py::gil_scoped_release release;
+
+                ::tbb::parallel_for(::tbb::blocked_range<decltype(sms.size())>(0, sms.size()),
+                                    [&x, &sms, &res](const auto &r) {
+                                        for (auto i = r.begin(); i != r.end(); ++i) {
+                                            res[i] = specialize(x, sms[i]);
+                                        }
+                                    });
+            }
+
+            py::list retval;
+            for (auto &r : res) {
+                retval.append(py::cast(::std::move(r)));
+            }
+
+            return retval;
+        });
     });
 
     // Constructors from polynomials with different coefficients
@@ -205,7 +553,13 @@ inline void expose_polynomial(py::module &m, type_getter &tg)
     m.def("byte_size", [](const p_type &p) { return ::obake::byte_size(p); });
 
     // Degree.
-    m.def("degree", [](const p_type &p) { return ::obake::degree(p); });
+    m.def("degree", [](const p_type &p) {
+        // NOTE: use the cached metadata, if exact.
+        if (auto md = series_metadata_get(p); md && md->m_exact) {
+            return md->m_max_degree;
+        }
+        return ::obake::degree(p);
+    });
     m.def("p_degree",
           [](const p_type &p, const py::iterable &s) { return ::obake::p_degree(p, py_object_to_obake_ss(s)); });
 
@@ -257,17 +611,46 @@ inline void expose_polynomial(py::module &m, type_getter &tg)
     // Explicit truncation.
     using deg_t = decltype(::obake::degree(::std::declval<const p_type &>()));
 #if (OBAKE_VERSION_MAJOR > 0) || (OBAKE_VERSION_MAJOR == 0 && OBAKE_VERSION_MINOR >= 4)
-    m.def("truncate_degree", [](p_type &x, const deg_t &n) { ::obake::truncate_degree(x, n); });
+    m.def("truncate_degree", [](p_type &x, const deg_t &n) {
+        // NOTE: nothing to do if the cached metadata
+        // guarantees that no term would be removed.
+        if (auto md = series_metadata_get(x); md && !(n < md->m_max_degree)) {
+            return;
+        }
+        series_metadata_drop(x);
+        ::obake::truncate_degree(x, n);
+    });
 
     using p_deg_t
         = decltype(::obake::p_degree(::std::declval<const p_type &>(), ::std::declval<const ::obake::symbol_set &>()));
     m.def("truncate_p_degree", [](p_type &x, const p_deg_t &n, const py::iterable &s) {
+        series_metadata_drop(x);
         ::obake::truncate_p_degree(x, n, py_object_to_obake_ss(s));
     });
 #else
     m.def("truncate_degree", [](const p_type &x, const deg_t &n) { return ::obake::truncate_degree(x, n); });
 #endif
 
+    // Frozen polynomials.
+    expose_frozen<p_type>(m);
+
+    // Power cache and truncated exponentiation.
+    expose_power_cache<p_type>(m);
+
+    // Polynomial matrices.
+    expose_poly_matrix<p_type>(m, poly_interop_types);
+
+    // Out-of-core multiplication.
+    expose_disk_series<p_type>(m, poly_interop_types);
+
+    // Conversions to/from SymPy and NumPy.
+    expose_converters<p_type>(m, poly_interop_types);
+
+    // Shared polynomials.
+    if constexpr (is_shareable_v<K, C>) {
+        expose_shared_polynomial<C>(m, poly_interop_types);
+    }
+
     // Add the current polynomial
     // type to the type getter.
     tg.add<K, C>(class_inst);
@@ -0,0 +1,217 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_POWER_CACHE_HPP
+#define OBAKE_PY_POWER_CACHE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <obake/key/key_degree.hpp>
+#include <obake/polynomials/polynomial.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include "estimate.hpp"
+#include "memory_budget.hpp"
+#include "type_system.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+// Truncated exponentiation needs the degrees of the
+// terms of the base to be non-negative. Otherwise,
+// a term discarded in an intermediate product could contribute
+// to the final result when multiplied by a negative-degree term.
+template <typename T>
+inline void check_truncated_pow_base(const T &x)
+{
+    const auto &ss = x.get_symbol_set();
+
+    for (const auto &t : x) {
+        if (::obake::key_degree(t.first, ss) < 0) {
+            throw ::std::invalid_argument("truncated exponentiation requires a polynomial whose terms all have a "
+                                          "non-negative degree");
+        }
+    }
+}
+
+// The unitary series with the same symbol set as x.
+template <typename T>
+inline T series_one_like(const T &x)
+{
+    T retval;
+    retval.set_symbol_set(x.get_symbol_set());
+    retval.add_term(typename T::key_type(x.get_symbol_set()), typename T::cf_type(1));
+
+    return retval;
+}
+
+// Multiplication, truncated if max_degree is not empty.
+template <typename T>
+inline T opt_truncated_mul(const T &a, const T &b, const ::std::optional<series_degree_t<T>> &max_degree)
+{
+    memory_budget_check([&a, &b, &max_degree]() { return estimate_product(a, b, max_degree); }, "mul");
+
+    if (max_degree) {
+        return ::obake::truncated_mul(a, b, *max_degree);
+    } else {
+        return a * b;
+    }
+}
+
+// Exponentiation by squaring, truncating the
+// intermediate products if max_degree is not empty.
+template <typename T>
+inline T truncated_pow(const T &x, long long n, const ::std::optional<series_degree_t<T>> &max_degree)
+{
+    if (n < 0) {
+        throw ::std::invalid_argument("truncated exponentiation requires a non-negative exponent, but the exponent "
+                                      + ::std::to_string(n) + " was provided instead");
+    }
+
+    auto retval = series_one_like(x);
+    auto base(x);
+
+    if (max_degree) {
+        check_truncated_pow_base(x);
+        truncate_degree_in_place(retval, *max_degree);
+        truncate_degree_in_place(base, *max_degree);
+    }
+
+    while (n != 0) {
+        if (n % 2 != 0) {
+            retval = opt_truncated_mul(retval, base, max_degree);
+        }
+        n /= 2;
+        if (n != 0) {
+            base = opt_truncated_mul(base, base, max_degree);
+        }
+    }
+
+    return retval;
+}
+
+// Cache of the natural powers of a series,
+// optionally truncated to a maximum degree.
+template <typename T>
+struct power_cache {
+    explicit power_cache(const T &base, const ::std::optional<series_degree_t<T>> &max_degree)
+        : m_base(base), m_max_degree(max_degree)
+    {
+        if (m_max_degree) {
+            check_truncated_pow_base(m_base);
+            truncate_degree_in_place(m_base, *m_max_degree);
+        }
+
+        m_powers.push_back(series_one_like(m_base));
+        if (m_max_degree) {
+            truncate_degree_in_place(m_powers.back(), *m_max_degree);
+        }
+    }
+
+    // Fetch the n-th power of the base. The missing
+    // powers are computed by multiplying the highest
+    // power already in the cache by the base.
+    T get(long long n)
+    {
+        if (n < 0) {
+            throw ::std::invalid_argument("a power cache can compute only non-negative powers, but the exponent "
+                                          + ::std::to_string(n) + " was provided instead");
+        }
+
+        const auto idx = static_cast<unsigned long long>(n);
+
+        ::std::lock_guard<::std::mutex> lock(m_mutex);
+
+        while (m_powers.size() <= idx) {
+            m_powers.push_back(opt_truncated_mul(m_powers.back(), m_base, m_max_degree));
+        }
+
+        return m_powers[static_cast<decltype(m_powers.size())>(idx)];
+    }
+
+    ::std::size_t size()
+    {
+        ::std::lock_guard<::std::mutex> lock(m_mutex);
+
+        return m_powers.size();
+    }
+
+    T m_base;
+    const ::std::optional<series_degree_t<T>> m_max_degree;
+    ::std::vector<T> m_powers;
+    ::std::mutex m_mutex;
+};
+
+// Convert a Python object into an optional degree.
+template <typename T>
+inline ::std::optional<series_degree_t<T>> py_object_to_opt_degree(const py::object &o)
+{
+    if (o.is_none()) {
+        return {};
+    }
+
+    return o.cast<series_degree_t<T>>();
+}
+
+// Expose the power cache and the truncated
+// exponentiation for the series type T.
+template <typename T>
+inline void expose_power_cache(py::module &m)
+{
+    using pc_type = power_cache<T>;
+
+    py::class_<pc_type> class_inst(m, ("_power_cache_type_" + ::std::to_string(exposed_types_counter++)).c_str());
+
+    // NOTE: the GIL is released during the computation
+    // of the powers, the cache is protected by a mutex.
+    class_inst.def("__getitem__", [](pc_type &pc, long long n) {
+        py::gil_scoped_release release;
+
+        return pc.get(n);
+    });
+    class_inst.def("__len__", [](pc_type &pc) { return pc.size(); });
+    class_inst.def_property_readonly("base", [](const pc_type &pc) { return pc.m_base; });
+    class_inst.def_property_readonly("max_degree", [](const pc_type &pc) -> py::object {
+        if (pc.m_max_degree) {
+            return py::cast(*pc.m_max_degree);
+        }
+        return py::none();
+    });
+
+    m.def("_power_cache", [](const T &x, const py::object &max_degree) {
+        const auto md = py_object_to_opt_degree<T>(max_degree);
+
+        py::gil_scoped_release release;
+
+        // NOTE: the power cache is not movable
+        // due to the mutex, use a unique_ptr.
+        return ::std::make_unique<pc_type>(x, md);
+    });
+
+    m.def("truncated_pow", [](const T &x, long long n, const series_degree_t<T> &max_degree) {
+        py::gil_scoped_release release;
+
+        return truncated_pow(x, n, ::std::optional<series_degree_t<T>>(max_degree));
+    });
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,126 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_SERIES_TABLE_HPP
+#define OBAKE_PY_SERIES_TABLE_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <obake/math/safe_cast.hpp>
+
+namespace obake_py
+{
+
+// Reserve space for n terms in the table(s) of x.
+// NOTE: the terms are assumed to be evenly
+// distributed among the segments.
+template <typename T>
+inline void series_reserve(T &x, unsigned long long n)
+{
+    auto &s_table = x._get_s_table();
+
+    const auto n_seg = static_cast<unsigned long long>(s_table.size());
+    const auto seg_n = n / n_seg + static_cast<unsigned long long>(n % n_seg != 0u);
+
+    for (auto &t : s_table) {
+        t.reserve(::obake::safe_cast<decltype(t.size())>(seg_n));
+    }
+}
+
+// The total number of buckets in the table(s) of x.
+template <typename T>
+inline unsigned long long series_capacity(const T &x)
+{
+    unsigned long long retval = 0;
+    for (const auto &t : x._get_s_table()) {
+        retval += static_cast<unsigned long long>(t.bucket_count());
+    }
+
+    return retval;
+}
+
+// Fetch the number of buckets in each table of x.
+template <typename T>
+inline auto series_bucket_counts(const T &x)
+{
+    ::std::vector<::std::size_t> retval;
+    for (const auto &t : x._get_s_table()) {
+        retval.push_back(static_cast<::std::size_t>(t.bucket_count()));
+    }
+
+    return retval;
+}
+
+// Grow the tables of x so that they have at least
+// the number of buckets in bcs, which must have been
+// fetched from a series with the same segmentation.
+// NOTE: the bucket counts are restored via rehash() (rather
+// than via reserve(), which takes a number of terms), so that
+// the capacity does not grow when restored repeatedly.
+template <typename T>
+inline void series_restore_bucket_counts(T &x, const ::std::vector<::std::size_t> &bcs)
+{
+    auto &s_table = x._get_s_table();
+    if (s_table.size() != bcs.size()) {
+        return;
+    }
+
+    for (decltype(s_table.size()) i = 0; i < s_table.size(); ++i) {
+        auto &t = s_table[i];
+        if (static_cast<::std::size_t>(t.bucket_count()) < bcs[i]) {
+            t.rehash(::obake::safe_cast<decltype(t.bucket_count())>(bcs[i]));
+        }
+    }
+}
+
+// Shrink the capacity of the table(s)
+// of x to the number of terms.
+template <typename T>
+inline void series_shrink_to_fit(T &x)
+{
+    for (auto &t : x._get_s_table()) {
+        t.rehash(0);
+    }
+}
+
+// Set the log2 of the number of segments
+// of x, preserving its terms.
+template <typename T>
+inline void series_set_n_segments(T &x, unsigned l)
+{
+    if (x.get_s_size() == l) {
+        // Nothing to do.
+        return;
+    }
+
+    if (x.empty()) {
+        x.set_n_segments(l);
+        return;
+    }
+
+    // Move the terms into a new series
+    // with the desired segmentation.
+    T tmp;
+    tmp.set_symbol_set(x.get_symbol_set());
+    tmp.set_n_segments(l);
+    series_reserve(tmp, x.size());
+
+    for (auto &t : x._get_s_table()) {
+        for (auto &[k, c] : t) {
+            tmp.add_term(k, ::std::move(c));
+        }
+    }
+
+    x = ::std::move(tmp);
+}
+
+} // namespace obake_py
+
+#endif
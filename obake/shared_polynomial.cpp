@@ -0,0 +1,157 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include <boost/hana/for_each.hpp>
+
+#include <obake/symbols.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include "shared_polynomial.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace hana = ::boost::hana;
+namespace py = ::pybind11;
+
+namespace detail
+{
+
+namespace
+{
+
+// Round up n to a multiple of 16, checking for overflow.
+::std::uint64_t shared_round_up(::std::uint64_t n)
+{
+    if (n > ::std::numeric_limits<::std::uint64_t>::max() - 15u) {
+        py_throw(::PyExc_OverflowError, "overflow in the computation of the layout of a shared polynomial");
+    }
+
+    return (n + 15u) / 16u * 16u;
+}
+
+// Overflow-checked a * b + c.
+::std::uint64_t shared_mul_add(::std::uint64_t a, ::std::uint64_t b, ::std::uint64_t c)
+{
+    if (b != 0u && a > (::std::numeric_limits<::std::uint64_t>::max() - c) / b) {
+        py_throw(::PyExc_OverflowError, "overflow in the computation of the layout of a shared polynomial");
+    }
+
+    return a * b + c;
+}
+
+} // namespace
+
+} // namespace detail
+
+shared_layout shared_compute_layout(::std::uint64_t ss_bytes, ::std::uint64_t n_terms, ::std::size_t cf_size)
+{
+    const auto ss_offset = detail::shared_round_up(sizeof(shared_header));
+    const auto keys_offset = detail::shared_round_up(detail::shared_mul_add(1, ss_bytes, ss_offset));
+    const auto cfs_offset
+        = detail::shared_round_up(detail::shared_mul_add(n_terms, sizeof(long long), keys_offset));
+    const auto total_size = detail::shared_mul_add(n_terms, cf_size, cfs_offset);
+
+    if (total_size > ::std::numeric_limits<::std::size_t>::max()) {
+        py_throw(::PyExc_OverflowError, "overflow in the computation of the layout of a shared polynomial");
+    }
+
+    return shared_layout{static_cast<::std::size_t>(ss_offset), static_cast<::std::size_t>(keys_offset),
+                         static_cast<::std::size_t>(cfs_offset), static_cast<::std::size_t>(total_size)};
+}
+
+::std::pair<py::buffer_info, ::std::size_t> shared_request_buffer(const py::buffer &b, bool writable)
+{
+    auto info = b.request(writable);
+
+    if (info.ndim != 1 || info.strides[0] != info.itemsize) {
+        py_throw(::PyExc_ValueError, "the buffer of a shared polynomial must be one-dimensional and contiguous");
+    }
+
+    const auto nbytes = static_cast<::std::size_t>(info.size) * static_cast<::std::size_t>(info.itemsize);
+
+    return {::std::move(info), nbytes};
+}
+
+py::object shared_attach(const py::buffer &b)
+{
+    auto [info, nbytes] = shared_request_buffer(b, false);
+    const auto *ptr = static_cast<const unsigned char *>(info.ptr);
+
+    // Read and validate the header.
+    if (nbytes < sizeof(shared_header)) {
+        py_throw(::PyExc_ValueError, "the buffer is too small to contain a shared polynomial");
+    }
+    shared_header h;
+    ::std::memcpy(&h, ptr, sizeof(h));
+
+    if (!::std::equal(::std::begin(shared_magic), ::std::end(shared_magic), h.magic)) {
+        py_throw(::PyExc_ValueError, "the buffer does not contain a shared polynomial");
+    }
+    if (h.version != shared_version) {
+        py_throw(::PyExc_ValueError, ("unsupported shared polynomial version " + ::std::to_string(h.version)
+                                      + " (the supported version is " + ::std::to_string(shared_version) + ")")
+                                         .c_str());
+    }
+
+    py::object retval;
+
+    hana::for_each(shared_cf_types, [&](auto t) {
+        using cf_t = typename decltype(t)::type;
+        using traits = shared_cf_traits<cf_t>;
+
+        if (h.cf_tag != traits::tag) {
+            return;
+        }
+
+        const auto layout = shared_compute_layout(h.ss_bytes, h.n_terms, traits::size);
+        if (nbytes < layout.total_size) {
+            py_throw(::PyExc_ValueError, "the buffer is too small to contain the shared polynomial it describes");
+        }
+
+        // Read the symbols.
+        ::obake::symbol_set ss;
+        const auto *s_ptr = reinterpret_cast<const char *>(ptr + layout.ss_offset);
+        const auto *const s_end = s_ptr + h.ss_bytes;
+        for (::std::uint64_t i = 0; i < h.n_symbols; ++i) {
+            const auto *const s_term = ::std::find(s_ptr, s_end, '\0');
+            if (s_term == s_end) {
+                py_throw(::PyExc_ValueError, "the symbol names of the shared polynomial are malformed");
+            }
+            ss.insert(ss.end(), ::std::string(s_ptr, s_term));
+            s_ptr = s_term + 1;
+        }
+        if (ss.size() != h.n_symbols) {
+            py_throw(::PyExc_ValueError, "the symbol names of the shared polynomial are malformed");
+        }
+
+        retval = py::cast(shared_polynomial<cf_t>{::std::move(info), nbytes, ::std::move(ss),
+                                                  static_cast<::std::size_t>(h.n_terms), ptr + layout.keys_offset,
+                                                  ptr + layout.cfs_offset});
+    });
+
+    if (!retval) {
+        py_throw(::PyExc_ValueError, ("unsupported coefficient type tag " + ::std::to_string(h.cf_tag)
+                                      + " in the shared polynomial")
+                                         .c_str());
+    }
+
+    return retval;
+}
+
+} // namespace obake_py
@@ -0,0 +1,435 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_SHARED_POLYNOMIAL_HPP
+#define OBAKE_PY_SHARED_POLYNOMIAL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <boost/hana/for_each.hpp>
+#include <boost/hana/tuple.hpp>
+
+#include <mp++/config.hpp>
+#include <mp++/integer.hpp>
+
+#if defined(MPPP_WITH_QUADMATH)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <obake/key/key_degree.hpp>
+#include <obake/key/key_evaluate.hpp>
+#include <obake/polynomials/packed_monomial.hpp>
+#include <obake/polynomials/polynomial.hpp>
+#include <obake/symbols.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+
+#include "estimate.hpp"
+#include "memory_budget.hpp"
+#include "type_system.hpp"
+#include "utils.hpp"
+
+namespace obake_py
+{
+
+namespace hana = ::boost::hana;
+namespace py = ::pybind11;
+
+// The flat layout of a shared polynomial is:
+//
+// - a header (see shared_header below),
+// - the names of the symbols, each terminated by
+//   a null character,
+// - the packed keys, as an array of 64-bit integers,
+// - the coefficients, as an array of fixed-width values.
+//
+// Each of the last 3 sections starts at an offset which is
+// a multiple of 16 bytes. The values are stored in the
+// native byte order.
+struct shared_header {
+    char magic[8];
+    ::std::uint64_t version;
+    ::std::uint64_t cf_tag;
+    ::std::uint64_t n_symbols;
+    ::std::uint64_t n_terms;
+    ::std::uint64_t ss_bytes;
+};
+
+inline constexpr char shared_magic[8] = {'O', 'B', 'A', 'K', 'E', 'S', 'H', 'M'};
+inline constexpr ::std::uint64_t shared_version = 1;
+
+// The key type of the shared polynomials.
+using shared_key_t = ::obake::packed_monomial<long long>;
+
+// The coefficient types which can be stored
+// in a shared polynomial.
+inline constexpr auto shared_cf_types = hana::tuple_t<double, ::mppp::integer<1>
+#if defined(MPPP_WITH_QUADMATH)
+                                                      ,
+                                                      ::mppp::real128
+#endif
+                                                      >;
+
+// Traits describing how coefficients
+// are stored in the flat layout.
+template <typename C>
+struct shared_cf_traits {
+    static constexpr bool value = false;
+};
+
+template <>
+struct shared_cf_traits<double> {
+    static constexpr bool value = true;
+    static constexpr ::std::uint64_t tag = 0;
+    static constexpr ::std::size_t size = sizeof(double);
+
+    static void write(unsigned char *ptr, const double &c)
+    {
+        ::std::memcpy(ptr, &c, size);
+    }
+    static double read(const unsigned char *ptr)
+    {
+        double retval;
+        ::std::memcpy(&retval, ptr, size);
+        return retval;
+    }
+};
+
+// NOTE: integers are stored as 64-bit values.
+template <>
+struct shared_cf_traits<::mppp::integer<1>> {
+    static constexpr bool value = true;
+    static constexpr ::std::uint64_t tag = 1;
+    static constexpr ::std::size_t size = sizeof(::std::int64_t);
+
+    static void write(unsigned char *ptr, const ::mppp::integer<1> &c)
+    {
+        // NOTE: this will throw std::overflow_error
+        // if c does not fit in 64 bits.
+        const auto tmp = static_cast<::std::int64_t>(c);
+        ::std::memcpy(ptr, &tmp, size);
+    }
+    static ::mppp::integer<1> read(const unsigned char *ptr)
+    {
+        ::std::int64_t retval;
+        ::std::memcpy(&retval, ptr, size);
+        return ::mppp::integer<1>{retval};
+    }
+};
+
+#if defined(MPPP_WITH_QUADMATH)
+
+template <>
+struct shared_cf_traits<::mppp::real128> {
+    static constexpr bool value = true;
+    static constexpr ::std::uint64_t tag = 2;
+    static constexpr ::std::size_t size = sizeof(::mppp::real128::m_value);
+
+    static void write(unsigned char *ptr, const ::mppp::real128 &c)
+    {
+        ::std::memcpy(ptr, &c.m_value, size);
+    }
+    static ::mppp::real128 read(const unsigned char *ptr)
+    {
+        ::mppp::real128 retval;
+        ::std::memcpy(&retval.m_value, ptr, size);
+        return retval;
+    }
+};
+
+#endif
+
+// Check if the polynomial type with key K
+// and coefficient C can be shared.
+template <typename K, typename C>
+inline constexpr bool is_shareable_v = ::std::is_same_v<K, shared_key_t> && shared_cf_traits<C>::value;
+
+// Offsets of the sections in the flat layout.
+struct shared_layout {
+    ::std::size_t ss_offset;
+    ::std::size_t keys_offset;
+    ::std::size_t cfs_offset;
+    ::std::size_t total_size;
+};
+
+// Compute the layout of a shared polynomial.
+shared_layout shared_compute_layout(::std::uint64_t, ::std::uint64_t, ::std::size_t);
+
+// Fetch a read-only buffer from the object b, checking that it
+// is contiguous. The size of the buffer in bytes is returned as well.
+::std::pair<py::buffer_info, ::std::size_t> shared_request_buffer(const py::buffer &, bool);
+
+// Read-only polynomial attached to a flat layout.
+template <typename C>
+struct shared_polynomial {
+    using traits = shared_cf_traits<C>;
+    using p_type = ::obake::polynomial<shared_key_t, C>;
+
+    shared_key_t key(::std::size_t i) const
+    {
+        long long value;
+        ::std::memcpy(&value, m_keys + i * sizeof(long long), sizeof(long long));
+        return shared_key_t(value);
+    }
+    C cf(::std::size_t i) const
+    {
+        return traits::read(m_cfs + i * traits::size);
+    }
+
+    // Convert to a regular polynomial.
+    p_type to_polynomial() const
+    {
+        p_type retval;
+        retval.set_symbol_set(m_ss);
+
+        for (::std::size_t i = 0; i < m_n_terms; ++i) {
+            retval.add_term(key(i), cf(i));
+        }
+
+        return retval;
+    }
+
+    auto degree() const
+    {
+        using deg_t = decltype(::obake::key_degree(key(0), m_ss));
+
+        if (m_n_terms == 0u) {
+            return deg_t(0);
+        }
+
+        return ::tbb::parallel_reduce(
+            ::tbb::blocked_range<::std::size_t>(0, m_n_terms), ::obake::key_degree(key(0), m_ss),
+            [this](const auto &r, deg_t cur) {
+                for (auto i = r.begin(); i != r.end(); ++i) {
+                    cur = ::std::max(cur, ::obake::key_degree(key(i), m_ss));
+                }
+                return cur;
+            },
+            [](const deg_t &a, const deg_t &b) { return ::std::max(a, b); });
+    }
+
+    template <typename T>
+    auto evaluate(const ::obake::symbol_map<T> &sm) const
+    {
+        // Build the evaluation map indexed
+        // by symbol position.
+        ::obake::symbol_idx_map<T> si;
+        ::obake::symbol_idx idx = 0;
+        for (const auto &s : m_ss) {
+            const auto it = sm.find(s);
+            if (it == sm.end()) {
+                throw ::std::invalid_argument(
+                    "Cannot evaluate a shared polynomial: the evaluation map does not contain all the symbols in "
+                    "the series' symbol set");
+            }
+            si.insert(si.end(), {idx++, it->second});
+        }
+
+        using ret_t = ::std::decay_t<decltype(cf(0) * ::obake::key_evaluate(key(0), si, m_ss))>;
+
+        return ::tbb::parallel_reduce(
+            ::tbb::blocked_range<::std::size_t>(0, m_n_terms), ret_t(0),
+            [this, &si](const auto &r, ret_t cur) {
+                for (auto i = r.begin(); i != r.end(); ++i) {
+                    cur += cf(i) * ::obake::key_evaluate(key(i), si, m_ss);
+                }
+                return cur;
+            },
+            [](const ret_t &a, const ret_t &b) { return a + b; });
+    }
+
+    // NOTE: the buffer info keeps the
+    // underlying memory alive.
+    py::buffer_info m_info;
+    ::std::size_t m_byte_size;
+    ::obake::symbol_set m_ss;
+    ::std::size_t m_n_terms;
+    const unsigned char *m_keys;
+    const unsigned char *m_cfs;
+    // The conversion to a regular polynomial,
+    // created on first use by the products.
+    // NOTE: this is accessed only with the GIL held.
+    mutable ::std::shared_ptr<const p_type> m_poly = nullptr;
+};
+
+// Fetch the conversion of s to a regular polynomial,
+// creating it if needed.
+// NOTE: this must be called with the GIL held.
+template <typename C>
+inline auto shared_to_polynomial_cached(const shared_polynomial<C> &s)
+{
+    using p_type = typename shared_polynomial<C>::p_type;
+
+    if (!s.m_poly) {
+        ::std::shared_ptr<const p_type> tmp;
+        {
+            py::gil_scoped_release release;
+
+            tmp = ::std::make_shared<const p_type>(s.to_polynomial());
+        }
+
+        // NOTE: another thread might have created
+        // the conversion in the meantime.
+        if (!s.m_poly) {
+            s.m_poly = ::std::move(tmp);
+        }
+    }
+
+    return s.m_poly;
+}
+
+// Size in bytes of the flat layout of p.
+template <typename C>
+inline ::std::size_t shared_export_size(const ::obake::polynomial<shared_key_t, C> &p)
+{
+    ::std::uint64_t ss_bytes = 0;
+    for (const auto &s : p.get_symbol_set()) {
+        ss_bytes += s.size() + 1u;
+    }
+
+    return shared_compute_layout(ss_bytes, p.size(), shared_cf_traits<C>::size).total_size;
+}
+
+// Write the flat layout of p into the buffer b.
+template <typename C>
+inline void shared_export(const ::obake::polynomial<shared_key_t, C> &p, const py::buffer &b)
+{
+    using traits = shared_cf_traits<C>;
+
+    const auto [info, nbytes] = shared_request_buffer(b, true);
+
+    const auto &ss = p.get_symbol_set();
+    ::std::uint64_t ss_bytes = 0;
+    for (const auto &s : ss) {
+        ss_bytes += s.size() + 1u;
+    }
+    const auto layout = shared_compute_layout(ss_bytes, p.size(), traits::size);
+
+    if (nbytes < layout.total_size) {
+        py_throw(::PyExc_ValueError, ("the buffer into which a polynomial is to be exported has a size of "
+                                      + ::std::to_string(nbytes) + " bytes, but a size of at least "
+                                      + ::std::to_string(layout.total_size) + " bytes is needed")
+                                         .c_str());
+    }
+
+    auto *ptr = static_cast<unsigned char *>(info.ptr);
+
+    py::gil_scoped_release release;
+
+    // Zero out the paddings.
+    ::std::memset(ptr, 0, layout.total_size);
+
+    // Header.
+    shared_header h{};
+    ::std::copy(::std::begin(shared_magic), ::std::end(shared_magic), h.magic);
+    h.version = shared_version;
+    h.cf_tag = traits::tag;
+    h.n_symbols = ss.size();
+    h.n_terms = p.size();
+    h.ss_bytes = ss_bytes;
+    ::std::memcpy(ptr, &h, sizeof(h));
+
+    // Symbols.
+    auto *s_ptr = ptr + layout.ss_offset;
+    for (const auto &s : ss) {
+        ::std::memcpy(s_ptr, s.c_str(), s.size() + 1u);
+        s_ptr += s.size() + 1u;
+    }
+
+    // Terms.
+    ::std::size_t i = 0;
+    for (const auto &[k, c] : p) {
+        ::std::memcpy(ptr + layout.keys_offset + i * sizeof(long long), &k.get_value(), sizeof(long long));
+        traits::write(ptr + layout.cfs_offset + i * traits::size, c);
+        ++i;
+    }
+}
+
+// Attach to a flat layout.
+py::object shared_attach(const py::buffer &);
+
+// Expose the shared polynomial class for the coefficient
+// type C. The shared polynomial can be evaluated
+// with values of the types in interop_types.
+template <typename C, typename Types>
+inline void expose_shared_polynomial(py::module &m, const Types &interop_types)
+{
+    using s_type = shared_polynomial<C>;
+    using p_type = typename s_type::p_type;
+
+    py::class_<s_type> class_inst(m, ("_shared_type_" + ::std::to_string(exposed_types_counter++)).c_str());
+
+    class_inst.def("__len__", [](const s_type &s) { return s.m_n_terms; });
+    class_inst.def("__repr__", [](const s_type &s) {
+        return "Shared polynomial with " + ::std::to_string(s.m_n_terms) + " terms over the symbols "
+               + py::repr(obake_ss_to_py_list(s.m_ss)).template cast<::std::string>();
+    });
+    class_inst.def_property_readonly("symbol_set", [](const s_type &s) { return obake_ss_to_py_list(s.m_ss); });
+    class_inst.def("to_polynomial", [](const s_type &s) {
+        py::gil_scoped_release release;
+
+        return s.to_polynomial();
+    });
+
+    // Multiplication as right-hand operand.
+    // NOTE: obake's multiplication needs a hash table, thus
+    // the shared polynomial is converted to a regular polynomial
+    // once, and the conversion is reused by all the products.
+    class_inst.def(
+        "__rmul__",
+        [](const s_type &s, const p_type &p) {
+            const auto q = shared_to_polynomial_cached(s);
+
+            py::gil_scoped_release release;
+
+            memory_budget_check([&p, &q]() { return estimate_product(p, *q); }, "mul");
+
+            return p * *q;
+        },
+        py::is_operator());
+
+    m.def("byte_size", [](const s_type &s) { return s.m_byte_size; });
+    m.def("degree", [](const s_type &s) {
+        py::gil_scoped_release release;
+
+        return s.degree();
+    });
+
+    hana::for_each(interop_types, [&m](auto t) {
+        using cur_t = typename decltype(t)::type;
+
+        m.def("_evaluate", [](const cur_t &, const s_type &s, const py::dict &d) {
+            const auto sm = py_dict_to_obake_sm<cur_t>(d);
+
+            py::gil_scoped_release release;
+
+            return s.evaluate(sm);
+        });
+    });
+
+    // Export functions.
+    m.def("_shared_export_size", [](const p_type &p) { return shared_export_size(p); });
+    m.def("_shared_export", [](const p_type &p, const py::buffer &b) { shared_export(p, b); });
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,100 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_SPECIALIZE_HPP
+#define OBAKE_PY_SPECIALIZE_HPP
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <obake/key/key_evaluate.hpp>
+#include <obake/key/key_trim.hpp>
+#include <obake/polynomials/polynomial.hpp>
+#include <obake/symbols.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "series_table.hpp"
+
+namespace obake_py
+{
+
+// Partial evaluation of the polynomial x: the symbols in sm are
+// evaluated, and the result is a polynomial over the remaining
+// symbols of x. The symbols in sm which do not appear in x are ignored.
+template <typename T, typename U>
+inline auto specialize(const T &x, const ::obake::symbol_map<U> &sm)
+{
+    using key_t = typename T::key_type;
+    using ret_cf_t = ::std::decay_t<decltype(
+        ::std::declval<const typename T::cf_type &>()
+        * ::obake::key_evaluate(::std::declval<const key_t &>(), ::std::declval<const ::obake::symbol_idx_map<U> &>(),
+                                ::std::declval<const ::obake::symbol_set &>()))>;
+    using ret_t = ::obake::polynomial<key_t, ret_cf_t>;
+
+    const auto &ss = x.get_symbol_set();
+
+    // Split the symbols of x into fixed
+    // (i.e., evaluated) and free symbols.
+    ::obake::symbol_idx_set fixed_idx, free_idx;
+    ::obake::symbol_set fixed_ss, free_ss;
+    // NOTE: the values of the fixed symbols are indexed
+    // by their positions in fixed_ss.
+    ::obake::symbol_idx_map<U> fixed_sm;
+    ::obake::symbol_idx i = 0, j = 0;
+    for (const auto &s : ss) {
+        if (const auto it = sm.find(s); it == sm.end()) {
+            free_idx.insert(free_idx.end(), i);
+            free_ss.insert(free_ss.end(), s);
+        } else {
+            fixed_idx.insert(fixed_idx.end(), i);
+            fixed_ss.insert(fixed_ss.end(), s);
+            fixed_sm.insert(fixed_sm.end(), {j++, it->second});
+        }
+        ++i;
+    }
+
+    // Compute the new terms in parallel, one
+    // segment of x at a time.
+    const auto &s_table = x._get_s_table();
+    ::std::vector<::std::vector<::std::pair<key_t, ret_cf_t>>> new_terms(s_table.size());
+
+    ::tbb::parallel_for(::tbb::blocked_range<decltype(s_table.size())>(0, s_table.size()), [&](const auto &r) {
+        for (auto idx = r.begin(); idx != r.end(); ++idx) {
+            auto &v = new_terms[idx];
+            v.reserve(s_table[idx].size());
+
+            for (const auto &[k, c] : s_table[idx]) {
+                v.emplace_back(::obake::key_trim(k, fixed_idx, ss),
+                               c * ::obake::key_evaluate(::obake::key_trim(k, free_idx, ss), fixed_sm, fixed_ss));
+            }
+        }
+    });
+
+    // Merge the new terms into the return value.
+    ret_t retval;
+    retval.set_symbol_set(free_ss);
+    retval.set_n_segments(x.get_s_size());
+    series_reserve(retval, x.size());
+
+    for (auto &v : new_terms) {
+        for (auto &[k, c] : v) {
+            retval.add_term(::std::move(k), ::std::move(c));
+        }
+        // NOTE: free the memory as soon as possible.
+        v = decltype(new_terms)::value_type{};
+    }
+
+    return retval;
+}
+
+} // namespace obake_py
+
+#endif
@@ -0,0 +1,65 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <atomic>
+
+#include <pybind11/pybind11.h>
+
+#include "sym_merge.hpp"
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+namespace detail
+{
+
+namespace
+{
+
+// The symbol merge counters.
+::std::atomic<unsigned long long> sym_merge_add_counter(0), sym_merge_sub_counter(0), sym_merge_mul_counter(0);
+
+} // namespace
+
+} // namespace detail
+
+void sym_merge_count(sym_merge_op op)
+{
+    switch (op) {
+        case sym_merge_op::add:
+            detail::sym_merge_add_counter.fetch_add(1u, ::std::memory_order_relaxed);
+            break;
+        case sym_merge_op::sub:
+            detail::sym_merge_sub_counter.fetch_add(1u, ::std::memory_order_relaxed);
+            break;
+        case sym_merge_op::mul:
+            detail::sym_merge_mul_counter.fetch_add(1u, ::std::memory_order_relaxed);
+    }
+}
+
+py::dict sym_merge_stats()
+{
+    py::dict retval;
+
+    retval["add"] = detail::sym_merge_add_counter.load(::std::memory_order_relaxed);
+    retval["sub"] = detail::sym_merge_sub_counter.load(::std::memory_order_relaxed);
+    retval["mul"] = detail::sym_merge_mul_counter.load(::std::memory_order_relaxed);
+
+    return retval;
+}
+
+void reset_sym_merge_stats()
+{
+    detail::sym_merge_add_counter.store(0, ::std::memory_order_relaxed);
+    detail::sym_merge_sub_counter.store(0, ::std::memory_order_relaxed);
+    detail::sym_merge_mul_counter.store(0, ::std::memory_order_relaxed);
+}
+
+} // namespace obake_py
@@ -0,0 +1,88 @@
+// Copyright 2019-2020 Francesco Biscani (bluescarni@gmail.com)
+//
+// This file is part of the obake.py library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef OBAKE_PY_SYM_MERGE_HPP
+#define OBAKE_PY_SYM_MERGE_HPP
+
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <obake/series.hpp>
+#include <obake/symbols.hpp>
+
+#include <pybind11/pybind11.h>
+
+namespace obake_py
+{
+
+namespace py = ::pybind11;
+
+// The arithmetic operations for which
+// symbol merges are counted.
+enum class sym_merge_op { add, sub, mul };
+
+// Record a symbol merge for the operation op.
+void sym_merge_count(sym_merge_op);
+
+// Fetch/reset the symbol merge counters.
+py::dict sym_merge_stats();
+void reset_sym_merge_stats();
+
+// Record a symbol merge for the operation op
+// if x and y have different symbol sets.
+template <typename T, typename U>
+inline void sym_merge_check(sym_merge_op op, const T &x, const U &y)
+{
+    if (x.get_symbol_set() != y.get_symbol_set()) {
+        sym_merge_count(op);
+    }
+}
+
+// Union of two symbol sets.
+inline ::obake::symbol_set sym_union(const ::obake::symbol_set &a, const ::obake::symbol_set &b)
+{
+    return ::std::get<0>(::obake::detail::merge_symbol_sets(a, b));
+}
+
+// Check that the symbol set ss contains
+// all the symbols in the symbol set of x.
+template <typename T>
+inline void sym_extend_check(const T &x, const ::obake::symbol_set &ss)
+{
+    if (sym_union(x.get_symbol_set(), ss).size() != ss.size()) {
+        throw ::std::invalid_argument("cannot extend the symbol set of a series to a symbol set which does not contain "
+                                      "all the symbols of the series");
+    }
+}
+
+// Extend in-place the symbol set of x to ss. ss
+// must be a superset of the symbol set of x.
+template <typename T>
+inline void sym_extend(T &x, const ::obake::symbol_set &ss)
+{
+    if (x.get_symbol_set() == ss) {
+        // Nothing to do.
+        return;
+    }
+
+    sym_extend_check(x, ss);
+
+    const auto ins_map = ::std::get<1>(::obake::detail::merge_symbol_sets(x.get_symbol_set(), ss));
+
+    T retval;
+    retval.set_symbol_set(ss);
+    ::obake::detail::series_sym_extender(retval, ::std::move(x), ins_map);
+
+    x = ::std::move(retval);
+}
+
+} // namespace obake_py
+
+#endif
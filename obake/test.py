@@ -50,6 +50,23 @@ class polynomials_test_case(_ut.TestCase):
         self.run_evaluate_tests()
         self.run_diff_integrate_tests()
         self.run_truncate_tests()
+        self.run_align_tests()
+        self.run_async_tests()
+        self.run_frozen_tests()
+        self.run_shared_tests()
+        self.run_power_cache_tests()
+        self.run_table_control_tests()
+        self.run_specialize_tests()
+        self.run_allocator_tests()
+        self.run_metadata_tests()
+        self.run_poly_matrix_tests()
+        self.run_addmul_tests()
+        self.run_dense_mul_tests()
+        self.run_evaluate_many_tests()
+        self.run_out_of_core_tests()
+        self.run_memory_budget_tests()
+        self.run_interrupt_tests()
+        self.run_converters_tests()
 
     def run_basic_tests(self):
         from itertools import product
@@ -519,6 +536,1335 @@ class polynomials_test_case(_ut.TestCase):
             self.assertEqual(t_p_degree((x-y)*(x+y)+x, 1, 'xy'), x)
             self.assertEqual(t_p_degree((x-y)*(x+y)+x, 1, 'x'), x-y**2)
 
+    def run_align_tests(self):
+        from itertools import product
+        from copy import copy
+        from . import polynomial, make_polynomials, align, symbol_merge_stats, reset_symbol_merge_stats
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+            a, b, c = copy(x), copy(y + z), copy(x * z)
+
+            self.assertEqual(align([a, b, c]), ['x', 'y', 'z'])
+            self.assertEqual(a.symbol_set, ['x', 'y', 'z'])
+            self.assertEqual(b.symbol_set, ['x', 'y', 'z'])
+            self.assertEqual(c.symbol_set, ['x', 'y', 'z'])
+            self.assertEqual(a, x)
+            self.assertEqual(b, y + z)
+            self.assertEqual(c, x * z)
+
+            # Explicit symbol set, with duplicates in the list.
+            self.assertEqual(
+                align([a, a, b], ss=['w', 'x', 'y', 'z']), ['w', 'x', 'y', 'z'])
+            self.assertEqual(a.symbol_set, ['w', 'x', 'y', 'z'])
+            self.assertEqual(b.symbol_set, ['w', 'x', 'y', 'z'])
+            self.assertEqual(a, x)
+
+            self.assertEqual(align([]), [])
+
+            with self.assertRaises(ValueError) as cm:
+                align([c], ss=['x'])
+            err = cm.exception
+            self.assertTrue(
+                "which does not contain all the symbols of the series" in str(err))
+            self.assertEqual(c.symbol_set, ['x', 'y', 'z'])
+
+            with self.assertRaises(TypeError) as cm:
+                align([x, 1])
+            err = cm.exception
+            self.assertTrue(
+                "all the polynomials passed to align() must be of the same type" in str(err))
+
+            # Symbol merge counters.
+            reset_symbol_merge_stats()
+            self.assertEqual(symbol_merge_stats(), {
+                             'add': 0, 'sub': 0, 'mul': 0})
+            x + x
+            x - x
+            x * x
+            self.assertEqual(symbol_merge_stats(), {
+                             'add': 0, 'sub': 0, 'mul': 0})
+            x + y
+            x2 = copy(x)
+            x2 -= y
+            x * y
+            x * y
+            self.assertEqual(symbol_merge_stats(), {
+                             'add': 1, 'sub': 1, 'mul': 2})
+            reset_symbol_merge_stats()
+            self.assertEqual(symbol_merge_stats(), {
+                             'add': 0, 'sub': 0, 'mul': 0})
+
+    def run_async_tests(self):
+        import asyncio
+        from itertools import product
+        from . import polynomial, make_polynomials, mul_async, pow_async, subs_async, subs
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+
+            # concurrent.futures interface.
+            futs = [mul_async(x + y, x - y), pow_async(x + y, 3),
+                    subs_async(x + y, {'x': z}), subs_async(x * y, {'x': 2})]
+            self.assertEqual(futs[0].result(), x**2 - y**2)
+            self.assertEqual(futs[1].result(), (x + y)**3)
+            self.assertEqual(futs[2].result(), z + y)
+            self.assertEqual(futs[3].result(), subs(x * y, {'x': 2}))
+            self.assertFalse(futs[0].cancel())
+
+            # asyncio interface.
+            async def run():
+                a = mul_async(x, y)
+                b = pow_async(x - z, 2)
+                return await a, await b
+
+            loop = asyncio.new_event_loop()
+            try:
+                self.assertEqual(loop.run_until_complete(
+                    run()), (x * y, (x - z)**2))
+            finally:
+                loop.close()
+
+            # The inputs can be modified in-place
+            # while the computation is running.
+            a, b = (x + y + z + 1)**8, (x - y - z - 1)**8
+            prod = a * b
+            futs = [mul_async(a, b), pow_async(a, 2),
+                    subs_async(a, {'x': b}), subs_async(a, {'x': 2})]
+            cmp = [prod, a**2, subs(a, {'x': b}), subs(a, {'x': 2})]
+            for _ in range(10):
+                a *= x
+                b += y
+            for f, c in zip(futs, cmp):
+                self.assertEqual(f.result(), c)
+
+            # Error handling.
+            with self.assertRaises(Exception) as cm:
+                (x + y)**.5
+            with self.assertRaises(type(cm.exception)):
+                pow_async(x + y, .5).result()
+
+            with self.assertRaises(TypeError) as cm:
+                subs_async(x, {'x': 1, 'y': 3.})
+
+    def run_frozen_tests(self):
+        from itertools import product
+        from copy import copy, deepcopy
+        from functools import lru_cache
+        from . import polynomial, make_polynomials, frozen
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+
+            fx = frozen(x)
+            self.assertEqual(fx.value, x)
+            self.assertEqual(fx.symbol_set, ['x'])
+            self.assertEqual(len(fx), 1)
+            self.assertTrue("frozen(" in repr(fx))
+            self.assertTrue(copy(fx) is fx)
+            self.assertTrue(deepcopy(fx) is fx)
+
+            # Hashing and equality.
+            self.assertEqual(hash(frozen(x + y)), hash(frozen(y + x)))
+            self.assertEqual(frozen(x + y), frozen(y + x))
+            self.assertEqual(hash(frozen((x + y)**10)),
+                             hash(frozen((y + x)**10)))
+            self.assertNotEqual(frozen(x + y), frozen(x - y))
+            self.assertNotEqual(frozen(x), frozen(x + 1))
+            self.assertNotEqual(frozen(x), frozen(y))
+
+            # Distinct monomials of equal degree.
+            self.assertNotEqual(hash(frozen(x * y)), hash(frozen(x**2)))
+            self.assertNotEqual(
+                hash(frozen(x * y**2)), hash(frozen(x**2 * y)))
+            self.assertNotEqual(hash(frozen(x * y)), hash(frozen(y * z)))
+            self.assertNotEqual(
+                hash(frozen(x**3 + y**3)), hash(frozen(x**2 * y + x * y**2)))
+
+            # Equality with different symbol sets.
+            xe, = make_polynomials(pt, 'x', ss=['x', 'y'])
+            self.assertEqual(frozen(xe), fx)
+            self.assertEqual(hash(frozen(xe)), hash(fx))
+            xe, ze = make_polynomials(pt, 'x', 'z', ss=['w', 'x', 'y', 'z'])
+            self.assertEqual(frozen(xe * ze**2 + 1), frozen(x * z**2 + 1))
+            self.assertEqual(hash(frozen(xe * ze**2 + 1)),
+                             hash(frozen(x * z**2 + 1)))
+
+            # The value is not affected by the
+            # modification of the original object.
+            x2 = copy(x)
+            fx2 = frozen(x2)
+            x2 += 1
+            self.assertEqual(fx2.value, x)
+
+            # Use as dict keys and memoisation.
+            d = {frozen(x): 1, frozen(y): 2}
+            self.assertEqual(d[frozen(copy(x))], 1)
+            self.assertEqual(d[frozen(y)], 2)
+
+            n_calls = [0]
+
+            @lru_cache(maxsize=None)
+            def sq(f):
+                n_calls[0] += 1
+                return frozen(f.value * f.value)
+
+            self.assertEqual(sq(frozen(x + y)).value, (x + y)**2)
+            self.assertEqual(sq(frozen(y + x)).value, (x + y)**2)
+            self.assertEqual(n_calls[0], 1)
+
+    def run_shared_tests(self):
+        import os
+        import tempfile
+        from . import polynomial, make_polynomials, types, export_shared, export_shared_size, attach_shared, degree, evaluate, byte_size
+        from .core import with_quadmath
+
+        cf_types = [types.double, types.integer]
+        if with_quadmath:
+            cf_types.append(types.real128)
+
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            for cf in cf_types:
+                pt = polynomial[types.packed_monomial, cf]
+
+                x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+                p = (x + 2 * y - z + 1)**6
+                fname = os.path.join(tmp_dir, 'p.bin')
+
+                export_shared(p, fname)
+                self.assertEqual(os.path.getsize(fname), export_shared_size(p))
+                s = attach_shared(fname)
+
+                self.assertEqual(len(s), len(p))
+                self.assertEqual(s.symbol_set, p.symbol_set)
+                self.assertEqual(s.to_polynomial(), p)
+                self.assertEqual(degree(s), degree(p))
+                self.assertTrue(byte_size(s) > 0)
+                self.assertTrue("Shared polynomial" in repr(s))
+                self.assertEqual((x - y) * s, (x - y) * p)
+                # The conversion to a regular
+                # polynomial is reused.
+                for i in range(3):
+                    self.assertEqual((x + i) * s, (x + i) * p)
+                if cf != types.real128:
+                    self.assertEqual(evaluate(s, {'x': 2, 'y': 3, 'z': 4}), evaluate(
+                        p, {'x': 2, 'y': 3, 'z': 4}))
+                    with self.assertRaises(ValueError) as cm:
+                        evaluate(s, {'x': 2, 'y': 3})
+                    err = cm.exception
+                    self.assertTrue(
+                        "does not contain all the symbols in the series'" in str(err))
+
+                # Export to a buffer.
+                buf = bytearray(export_shared_size(p))
+                export_shared(p, buf)
+                self.assertEqual(attach_shared(buf).to_polynomial(), p)
+
+                # Empty polynomial.
+                buf = bytearray(export_shared_size(pt()))
+                export_shared(pt(), buf)
+                self.assertEqual(len(attach_shared(buf)), 0)
+                self.assertEqual(degree(attach_shared(buf)), 0)
+
+                # Error handling.
+                with self.assertRaises(ValueError) as cm:
+                    export_shared(p, bytearray(10))
+                err = cm.exception
+                self.assertTrue("bytes is needed" in str(err))
+
+                with self.assertRaises(ValueError) as cm:
+                    attach_shared(bytes(100))
+                err = cm.exception
+                self.assertTrue(
+                    "the buffer does not contain a shared polynomial" in str(err))
+
+                with self.assertRaises(ValueError) as cm:
+                    attach_shared(bytes(buf[:10]))
+                err = cm.exception
+                self.assertTrue(
+                    "the buffer is too small to contain a shared polynomial" in str(err))
+
+                if cf == types.integer:
+                    with self.assertRaises(OverflowError):
+                        export_shared(x * 2**70, bytearray(
+                            export_shared_size(x)))
+
+                del s
+
+    def run_power_cache_tests(self):
+        from itertools import product
+        from copy import deepcopy
+        from . import polynomial, make_polynomials, PowerCache, power_cache, truncated_pow, truncate_degree
+
+        def t_degree(p, d):
+            pc = deepcopy(p)
+            ret = truncate_degree(pc, d)
+            return pc if ret is None else ret
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+            p = 1 + x + y - z
+
+            # Untruncated cache.
+            pc = PowerCache(p)
+            self.assertEqual(len(pc), 1)
+            self.assertTrue(pc.max_degree is None)
+            self.assertEqual(pc.base, p)
+            self.assertEqual(pc[0], 1)
+            self.assertEqual(pc[0].symbol_set, p.symbol_set)
+            self.assertEqual(pc[4], p**4)
+            self.assertEqual(len(pc), 5)
+            self.assertEqual(pc[2], p**2)
+            self.assertEqual(len(pc), 5)
+            self.assertEqual(pc[6], p**6)
+
+            # The returned powers are copies.
+            p2 = pc[2]
+            p2 += 1
+            self.assertEqual(pc[2], p**2)
+
+            # Truncated cache.
+            pc = PowerCache(p, max_degree=3)
+            self.assertEqual(pc.max_degree, 3)
+            for n in range(0, 7):
+                self.assertEqual(pc[n], t_degree(p**n, 3))
+            self.assertEqual(PowerCache(p, -1)[0], 0)
+
+            # The snake_case alias.
+            self.assertTrue(power_cache is PowerCache)
+            self.assertEqual(power_cache(p, 3)[4], t_degree(p**4, 3))
+
+            # Truncated pow.
+            for n in range(0, 7):
+                self.assertEqual(truncated_pow(p, n, 4), t_degree(p**n, 4))
+            self.assertEqual(truncated_pow(p, 10, 0), 1)
+
+            # Error handling.
+            with self.assertRaises(ValueError) as cm:
+                pc[-1]
+            err = cm.exception
+            self.assertTrue(
+                "a power cache can compute only non-negative powers" in str(err))
+
+            with self.assertRaises(ValueError) as cm:
+                truncated_pow(p, -1, 2)
+            err = cm.exception
+            self.assertTrue(
+                "truncated exponentiation requires a non-negative exponent" in str(err))
+
+            with self.assertRaises(ValueError) as cm:
+                truncated_pow(p + x**-1, 2, 2)
+            err = cm.exception
+            self.assertTrue(
+                "whose terms all have a non-negative degree" in str(err))
+
+            with self.assertRaises(ValueError) as cm:
+                PowerCache(p + x**-1, 2)
+            err = cm.exception
+            self.assertTrue(
+                "whose terms all have a non-negative degree" in str(err))
+
+    def run_table_control_tests(self):
+        from itertools import product
+        from copy import copy
+        from . import polynomial, make_polynomials
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z', ss=['x', 'y', 'z'])
+
+            # Pre-sized accumulation.
+            acc = pt()
+            self.assertEqual(acc.get_n_segments(), 0)
+            acc.set_n_segments(2)
+            self.assertEqual(acc.get_n_segments(), 2)
+            acc = x - x
+            acc.set_n_segments(2)
+            acc.reserve(1000)
+            cap = acc.get_capacity()
+            self.assertTrue(cap >= 1000)
+            for i in range(100):
+                acc += x**i * y
+            self.assertEqual(acc.get_n_segments(), 2)
+            self.assertTrue(acc.get_capacity() >= cap)
+            self.assertEqual(len(acc), 100)
+            self.assertEqual(acc, sum([x**i * y for i in range(100)], pt()))
+
+            # Resegmentation of a non-empty series.
+            p = (x + y + z)**5
+            p2 = copy(p)
+            p2.set_n_segments(3)
+            self.assertEqual(p2.get_n_segments(), 3)
+            self.assertEqual(p2, p)
+            p2.set_n_segments(0)
+            self.assertEqual(p2.get_n_segments(), 0)
+            self.assertEqual(p2, p)
+
+            # Shrink to fit.
+            p2.reserve(100000)
+            p2.shrink_to_fit()
+            self.assertEqual(p2, p)
+
+            # In-place multiplication preserves the segmentation.
+            p2.set_n_segments(4)
+            p2.reserve(100000)
+            cap = p2.get_capacity()
+            p2 *= x
+            self.assertTrue(p2.get_n_segments() >= 4)
+            self.assertTrue(p2.get_capacity() >= cap)
+            self.assertEqual(p2, p * x)
+
+            # The capacity is stable under repeated
+            # in-place multiplications.
+            p3 = x + y
+            p3.reserve(1000)
+            cap = p3.get_capacity()
+            one = pt(1)
+            for i in range(10):
+                p3 *= one
+                self.assertEqual(p3.get_capacity(), cap)
+            self.assertEqual(p3, x + y)
+
+    def run_specialize_tests(self):
+        from fractions import Fraction as F
+        from itertools import product
+        from . import polynomial, make_polynomials, specialize, specialize_many, subs, evaluate
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+            p = (x + 2 * y - 3 * z + 1)**4 + x * y**3
+
+            s = specialize(p, {'x': 2})
+            self.assertEqual(s.symbol_set, ['y', 'z'])
+            self.assertEqual(s, subs(p, {'x': 2}))
+
+            s = specialize(p, {'x': 2, 'z': 3, 'w': 4})
+            self.assertEqual(s.symbol_set, ['y'])
+            self.assertEqual(s, subs(p, {'x': 2, 'z': 3}))
+
+            s = specialize(p, {'x': F(1, 2)})
+            self.assertEqual(s.symbol_set, ['y', 'z'])
+            self.assertEqual(s, subs(p, {'x': F(1, 2)}))
+
+            s = specialize(p, {'x': 1, 'y': 2, 'z': 3})
+            self.assertEqual(s.symbol_set, [])
+            self.assertEqual(s, evaluate(p, {'x': 1, 'y': 2, 'z': 3}))
+
+            s = specialize(p, {'w': 1})
+            self.assertEqual(s.symbol_set, ['x', 'y', 'z'])
+            self.assertEqual(s, p)
+
+            # Batched version.
+            self.assertEqual(specialize_many(p, []), [])
+            ds = [{'x': i, 'z': -i} for i in range(1, 10)]
+            self.assertEqual(specialize_many(p, ds),
+                             [specialize(p, d) for d in ds])
+
+            # Error handling.
+            with self.assertRaises(TypeError) as cm:
+                specialize(p, {'x': 1, 'y': 3.})
+            err = cm.exception
+            self.assertTrue(
+                "the values in a substitution/evaluation map must be all of the same type" in str(err))
+
+            with self.assertRaises(TypeError) as cm:
+                specialize_many(p, [{'x': 1}, {'y': 3.}])
+            err = cm.exception
+            self.assertTrue(
+                "the values in the evaluation maps passed to specialize_many() must be all of the same type" in str(err))
+
+    def run_allocator_tests(self):
+        from itertools import product
+        from . import polynomial, make_polynomials, types, allocator, set_allocator, get_allocator, allocator_stats, reset_allocator_stats
+
+        orig = get_allocator()
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+            p = (2**100 * x + 3**80 * y - z + 1)
+
+            with allocator('system'):
+                self.assertEqual(get_allocator(), 'system')
+                res_system = p**6
+
+            with allocator('pooled'):
+                self.assertEqual(get_allocator(), 'pooled')
+                reset_allocator_stats()
+                res_pooled = p**6
+                # A serial workload which frees and reallocates
+                # blocks of the same sizes in the same thread.
+                # NOTE: the coefficients are large enough to
+                # bypass the limb caches of mp++.
+                if t[1] in [types.integer, types.rational]:
+                    big = 2**1000 * res_pooled
+                    for _ in range(5):
+                        r = big - 1
+                stats = allocator_stats()
+
+            self.assertEqual(get_allocator(), orig)
+            self.assertEqual(res_system, res_pooled)
+
+            self.assertEqual(set(stats.keys()), set(
+                ['allocations', 'reallocations', 'deallocations', 'pool_hits', 'bytes', 'peak']))
+            self.assertTrue(stats['peak'] >= 0)
+            if t[1] in [types.integer, types.rational]:
+                self.assertTrue(stats['allocations'] > 0)
+                self.assertTrue(stats['pool_hits'] > 0)
+
+        with self.assertRaises(ValueError) as cm:
+            set_allocator('foo')
+        err = cm.exception
+        self.assertTrue(
+            "the allocator must be either 'system' or 'pooled', but 'foo' was specified instead" in str(err))
+
+        set_allocator(orig)
+
+    def run_metadata_tests(self):
+        from .core import _obake_cpp_version_major, _obake_cpp_version_minor
+        from itertools import product
+        from . import polynomial, make_polynomials, degree, truncate_degree
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+
+            # Empty series.
+            md = pt().metadata
+            self.assertTrue(md.exact)
+            self.assertEqual(md.degree_bounds, (0, 0))
+            self.assertEqual(md.exponent_bounds, {})
+
+            p = x**2 * y + 3 * z**4 - x * y * z + 1
+            md = p.metadata
+            self.assertTrue(md.exact)
+            self.assertEqual(md.symbol_set, ['x', 'y', 'z'])
+            self.assertEqual(md.degree_bounds, (0, 4))
+            self.assertEqual(md.exponent_bounds, {
+                             'x': (0, 2), 'y': (0, 1), 'z': (0, 4)})
+            self.assertTrue(p.metadata is md)
+            self.assertEqual(degree(p), 4)
+
+            # The cached metadata cannot be overwritten.
+            with self.assertRaises(AttributeError):
+                p.metadata = x.metadata
+            with self.assertRaises(AttributeError):
+                p._obake_metadata = x.metadata
+            self.assertEqual(degree(p), 4)
+
+            # The cache is discarded when a polynomial is
+            # destroyed, and it is not inherited by the polynomials
+            # which are later created at the same address.
+            for i in range(100):
+                q = x**i * y
+                self.assertEqual(q.metadata.degree_bounds, (i + 1, i + 1))
+                self.assertEqual(degree(q), i + 1)
+                del q
+
+            # Propagation via arithmetics.
+            q = x * y**3
+            q.metadata
+            prod = p * q
+            self.assertFalse(prod.metadata.exact)
+            self.assertEqual(prod.metadata.degree_bounds, (4, 8))
+            self.assertEqual(prod.metadata.exponent_bounds, {
+                             'x': (1, 3), 'y': (3, 4), 'z': (0, 4)})
+            s = p - q
+            self.assertFalse(s.metadata.exact)
+            self.assertEqual(s.metadata.degree_bounds, (0, 4))
+            self.assertEqual((-p).metadata.degree_bounds, (0, 4))
+
+            # Without cached metadata on both operands,
+            # the metadata is computed from scratch.
+            prod = p * x
+            self.assertTrue(prod.metadata.exact)
+            self.assertEqual(prod.metadata.degree_bounds, (1, 5))
+
+            # In-place operations drop the metadata.
+            p += z**7
+            self.assertTrue(p.metadata.exact)
+            self.assertEqual(p.metadata.degree_bounds, (0, 7))
+            p *= 2
+            self.assertEqual(p.metadata.degree_bounds, (0, 7))
+            p -= 2
+            self.assertEqual(p.metadata.degree_bounds, (3, 7))
+
+            # Overflow check against the limits of the monomial type.
+            e = 1
+            while True:
+                r = (x * y * z)**e
+                try:
+                    r * r
+                except OverflowError:
+                    break
+                e *= 2
+            r.metadata
+            with self.assertRaises(OverflowError) as cm:
+                r * r
+            self.assertTrue(
+                "the exponents of the product of two polynomials would overflow" in str(cm.exception))
+            with self.assertRaises(OverflowError) as cm:
+                r *= r
+            self.assertTrue(
+                "the exponents of the product of two polynomials would overflow" in str(cm.exception))
+            self.assertEqual(r, (x * y * z)**e)
+
+            # Truncation.
+            if _obake_cpp_version_major > 1 or (_obake_cpp_version_major == 0 and _obake_cpp_version_minor >= 4):
+                p.metadata
+                truncate_degree(p, 10)
+                self.assertEqual(p.metadata.degree_bounds, (3, 7))
+                truncate_degree(p, 3)
+                self.assertTrue(p.metadata.exact)
+                self.assertEqual(p.metadata.degree_bounds, (3, 3))
+                self.assertEqual(p, 2 * x**2 * y - 2 * x * y * z)
+
+    def run_poly_matrix_tests(self):
+        from itertools import product
+        from copy import copy
+        from . import polynomial, make_polynomials, PolyMatrix, poly_matrix, evaluate, truncate_degree, degree
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+
+            A = PolyMatrix([[x, y + 1], [z, pt(2)], [x * y, x - z]])
+            self.assertEqual(A.shape, (3, 2))
+            self.assertEqual(A.symbol_set, ['x', 'y', 'z'])
+            self.assertEqual(A[0, 1], y + 1)
+            self.assertEqual(A[-1, -1], x - z)
+            self.assertEqual(A[1, 1].symbol_set, ['x', 'y', 'z'])
+
+            At = A.transpose()
+            self.assertEqual(At.shape, (2, 3))
+            self.assertEqual(At[1, 0], y + 1)
+            self.assertEqual(At.transpose(), A)
+
+            # Matrix-matrix product.
+            B = PolyMatrix([[x, y], [z, x + y]])
+            C = A @ B
+            self.assertEqual(C.shape, (3, 2))
+            Al, Bl = A.tolist(), B.tolist()
+            for i in range(3):
+                for j in range(2):
+                    self.assertEqual(
+                        C[i, j], sum([Al[i][k] * Bl[k][j] for k in range(2)], pt()))
+
+            # Matrix-vector product, with a new symbol.
+            w, = make_polynomials(pt, 'w')
+            v = A @ [w, x]
+            self.assertEqual(len(v), 3)
+            self.assertEqual(v[0], x * w + (y + 1) * x)
+            self.assertEqual(v[2].symbol_set, ['w', 'x', 'y', 'z'])
+
+            # Cancellations in the accumulation.
+            D = PolyMatrix([[x + y, x - y]]) @ PolyMatrix([[x - y], [-(x + y)]])
+            self.assertEqual(D[0, 0], pt())
+
+            # The snake_case alias.
+            self.assertTrue(poly_matrix is PolyMatrix)
+
+            # Setting an entry.
+            A2 = copy(A)
+            A2[1, 0] = w
+            self.assertEqual(A2.symbol_set, ['w', 'x', 'y', 'z'])
+            self.assertEqual(A2[1, 0], w)
+            self.assertEqual(A[1, 0], z)
+
+            # Elementwise truncation.
+            C2 = copy(C)
+            truncate_degree(C2, 1)
+            for i in range(3):
+                for j in range(2):
+                    self.assertTrue(degree(C2[i, j]) <= 1)
+
+            # Evaluation.
+            try:
+                import numpy as np
+                ev = evaluate(A, {'x': 1, 'y': 2, 'z': 3})
+                self.assertEqual(ev.shape, (3, 2))
+                self.assertEqual(ev[2][0], 2)
+                self.assertEqual(ev[0][1], 3)
+            except ImportError:
+                pass
+
+            # Error handling.
+            with self.assertRaises(ValueError) as cm:
+                A @ A
+            err = cm.exception
+            self.assertTrue(
+                "cannot multiply a polynomial matrix with 2 column(s) by a polynomial matrix with 3 row(s)" in str(err))
+
+            with self.assertRaises(ValueError) as cm:
+                PolyMatrix([[x, y], [z]])
+            err = cm.exception
+            self.assertTrue(
+                "all the rows of a polynomial matrix must have the same size, but rows of size 2 and 1 were encountered instead" in str(err))
+
+            with self.assertRaises(ValueError) as cm:
+                PolyMatrix([])
+            err = cm.exception
+            self.assertTrue(
+                "cannot create an empty polynomial matrix" in str(err))
+
+            with self.assertRaises(IndexError) as cm:
+                A[3, 0]
+            err = cm.exception
+            self.assertTrue(
+                "the index (3, 0) is out of bounds for a polynomial matrix of shape (3, 2)" in str(err))
+
+    def run_addmul_tests(self):
+        from .core import _obake_cpp_version_major, _obake_cpp_version_minor
+        from itertools import product
+        from copy import copy
+        from . import polynomial, make_polynomials, truncate_degree
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+            a = (x + y - 2 * z + 1)**3
+            b = (x - y + z)**2
+
+            acc = copy(a)
+            acc.addmul(a, b)
+            self.assertEqual(acc, a + a * b)
+            acc.submul(a, b)
+            self.assertEqual(acc, a)
+
+            # Accumulation loop.
+            acc = pt()
+            for i in range(5):
+                acc.addmul(x**i, b)
+            self.assertEqual(acc, sum([x**i * b for i in range(5)], pt()))
+
+            # Aliasing.
+            acc = copy(b)
+            acc.addmul(acc, acc)
+            self.assertEqual(acc, b + b * b)
+            acc.submul(b, acc)
+            self.assertEqual(acc, b + b * b - b * (b + b * b))
+
+            # Symbol set merging.
+            w, = make_polynomials(pt, 'w')
+            acc = copy(w)
+            acc.addmul(x, y)
+            self.assertEqual(acc.symbol_set, ['w', 'x', 'y'])
+            self.assertEqual(acc, w + x * y)
+
+            # Empty operands.
+            acc = copy(a)
+            acc.addmul(pt(), b)
+            self.assertEqual(acc, a)
+
+            # Large operands, multiplied in parallel.
+            la = (x + y - 2 * z + 1)**10
+            lb = (x - y + z - 3)**10
+            acc = copy(a)
+            acc.addmul(la, lb)
+            self.assertEqual(acc, a + la * lb)
+            acc.submul(lb, la)
+            self.assertEqual(acc, a)
+
+            # Degree truncation.
+            if _obake_cpp_version_major > 1 or (_obake_cpp_version_major == 0 and _obake_cpp_version_minor >= 4):
+                acc = copy(a)
+                acc.addmul(a, b, max_degree=3)
+                cmp = a * b
+                truncate_degree(cmp, 3)
+                self.assertEqual(acc, a + cmp)
+                acc = copy(a)
+                acc.submul(a, b, 1)
+                cmp = a * b
+                truncate_degree(cmp, 1)
+                self.assertEqual(acc, a - cmp)
+                acc = copy(a)
+                acc.addmul(la, lb, 12)
+                cmp = la * lb
+                truncate_degree(cmp, 12)
+                self.assertEqual(acc, a + cmp)
+
+    def run_dense_mul_tests(self):
+        from itertools import product
+        from . import polynomial, make_polynomials, mul, evaluate, types
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+
+            def check(a, b, integral=True):
+                sparse = mul(a, b, 'sparse')
+                self.assertEqual(sparse, a * b)
+                # The automatic method never alters the result.
+                self.assertEqual(mul(a, b, 'auto'), sparse)
+                if t[1] != types.double:
+                    # The dense method is available only for
+                    # double-precision coefficients.
+                    return
+                res = mul(a, b, 'dense')
+                self.assertEqual(res.symbol_set, sparse.symbol_set)
+                if integral:
+                    # With small integral coefficients, the
+                    # rounding errors of the FFT are removed.
+                    self.assertEqual(res, sparse)
+                    return
+                # NOTE: otherwise, the FFT introduces rounding errors,
+                # and exact cancellations may leave residual terms.
+                self.assertTrue(len(res) >= len(sparse))
+                pt_map = dict([(s, .5 + i / 10.)
+                               for i, s in enumerate(res.symbol_set)])
+                self.assertAlmostEqual(
+                    evaluate(res, pt_map), evaluate(sparse, pt_map))
+
+            # Dense products.
+            check((x + y + z + 1)**4, (x - 2 * y + z - 1)**4)
+            check((x + y + z + 1)**8, (x - 2 * y + z - 1)**8)
+            # Exact cancellations.
+            check((x + y)**10, (x - y)**10)
+            # Non-integral coefficients.
+            check((x / 3 + y + z + 1)**4, (x - y / 7 + z - 1)**4,
+                  t[1] != types.double)
+            check((x + y / 3)**10, (x - y / 3)**10, t[1] != types.double)
+            # Sparse products.
+            check(x**20 + y**20, z**20 + x * y)
+            # Symbol set merging.
+            w, = make_polynomials(pt, 'w')
+            check(x * y + 3, (w - x)**3)
+            # Empty operands.
+            check(pt(), x + y)
+
+            # Error handling.
+            with self.assertRaises(ValueError) as cm:
+                mul(x, y, 'foo')
+            err = cm.exception
+            self.assertTrue(
+                "the multiplication method must be one of 'auto', 'sparse' or 'dense', but 'foo' was specified instead" in str(err))
+
+            if t[1] == types.double:
+                # Small coefficients are not dropped, and a wide dynamic
+                # range of the coefficients triggers the exact product.
+                a, b = x + 1e-12, y + 1
+                self.assertEqual(mul(a, b, 'dense'), a * b)
+                self.assertEqual(len(mul(a, b, 'dense')), 4)
+
+                with self.assertRaises(ValueError) as cm:
+                    mul(x**10000 + 1, y**10000 + z**10000, 'dense')
+                err = cm.exception
+                self.assertTrue(
+                    "the dense representation of the product of two polynomials would require more than" in str(err))
+            else:
+                with self.assertRaises(ValueError) as cm:
+                    mul(x + 1, y + 1, 'dense')
+                err = cm.exception
+                self.assertTrue(
+                    "the dense multiplication method is available only for polynomials with double-precision coefficients" in str(err))
+
+            with self.assertRaises(TypeError) as cm:
+                mul(x, 1)
+
+    def run_evaluate_many_tests(self):
+        from fractions import Fraction as F
+        from itertools import product
+        import math
+        from . import polynomial, make_polynomials, evaluate, evaluate_many, types
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+            polys = [(x + y - 2 * z)**i + x * y**3 for i in range(10)]
+            polys.append(pt())
+            polys.append(pt(3))
+            polys.append(y**7)
+
+            for d in [{'x': 1, 'y': 2, 'z': 3}, {'x': F(1, 2), 'y': F(-1, 3), 'z': F(2, 5), 'w': F(1)}]:
+                self.assertEqual(evaluate_many(polys, d), [
+                                 evaluate(p, d) for p in polys])
+
+            # A null value for a symbol appearing with negative
+            # exponents must not spoil its non-negative powers.
+            if t[1] == types.double:
+                zpolys = [x**-1 + y, x**2 + y, y - x * z, pt(2)]
+                d = {'x': 0., 'y': 2., 'z': 3.}
+                res = evaluate_many(zpolys, d)
+                self.assertTrue(math.isinf(res[0]))
+                self.assertEqual(res[1:], [evaluate(p, d)
+                                           for p in zpolys[1:]])
+                self.assertEqual(res[1:], [2., 2., 2.])
+
+            # Cached metadata.
+            for p in polys:
+                p.metadata
+            d = {'x': 3, 'y': -2, 'z': 5}
+            self.assertEqual(evaluate_many(polys, d), [
+                             evaluate(p, d) for p in polys])
+
+            # The cached metadata cannot be tampered with.
+            p = x**2 * y**3
+            with self.assertRaises(AttributeError):
+                p.metadata = x.metadata
+            self.assertEqual(evaluate_many([p], d), [evaluate(p, d)])
+
+            self.assertEqual(evaluate_many([], d), [])
+
+            try:
+                import numpy as np
+                arr = evaluate_many(polys, d, as_array=True)
+                self.assertEqual(arr.shape, (len(polys),))
+            except ImportError:
+                pass
+
+            # Error handling.
+            with self.assertRaises(ValueError) as cm:
+                evaluate_many(polys, {'x': 1, 'y': 2})
+            err = cm.exception
+            self.assertTrue(
+                "cannot evaluate a list of polynomials: the evaluation map does not contain the symbol 'z'" in str(err))
+
+            with self.assertRaises(TypeError) as cm:
+                evaluate_many(polys, {'x': 1, 'y': 2, 'z': 3.})
+            err = cm.exception
+            self.assertTrue(
+                "the values in a substitution/evaluation map must be all of the same type" in str(err))
+
+    def run_out_of_core_tests(self):
+        import os
+        import tempfile
+        from .core import _obake_cpp_version_major, _obake_cpp_version_minor, _to_terms
+        from itertools import product
+        from . import polynomial, make_polynomials, mul_out_of_core, evaluate, truncate_degree, degree, byte_size
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+            a = (x + y - 2 * z + 1)**6
+            b = (x - y + z - 3)**6
+            prod = a * b
+
+            # Large budget: a single partition.
+            dp = mul_out_of_core(a, b, 1 << 40)
+            self.assertEqual(dp.n_partitions, 1)
+            self.assertEqual(len(dp), len(prod))
+            self.assertEqual(dp.to_polynomial(), prod)
+            self.assertEqual(dp.symbol_set, ['x', 'y', 'z'])
+            d = dp.path
+            dp.remove()
+            self.assertFalse(os.path.exists(d))
+
+            # Small budget: many partitions.
+            dp = mul_out_of_core(a, b, 1024)
+            self.assertTrue(dp.n_partitions > 1)
+            self.assertEqual(len(dp), len(prod))
+            self.assertEqual(sum(list(dp), pt()), prod)
+            self.assertEqual(sum([len(p) for p in dp]), len(prod))
+            self.assertEqual(dp.to_polynomial(), prod)
+            ev_d = {'x': 1, 'y': 2, 'z': 3}
+            self.assertEqual(evaluate(dp, ev_d), evaluate(prod, ev_d))
+
+            # A skewed product: the partitions
+            # fit in the memory budget.
+            sk = (1 + x + y + z)**6
+            sk_dp = mul_out_of_core(sk, sk, 1 << 14)
+            self.assertEqual(sk_dp.to_polynomial(), sk * sk)
+            self.assertTrue(all([byte_size(p) <= 1 << 14 for p in sk_dp]))
+            del sk_dp
+
+            # Truncation.
+            if _obake_cpp_version_major > 1 or (_obake_cpp_version_major == 0 and _obake_cpp_version_minor >= 4):
+                truncate_degree(dp, 5)
+                tprod = prod * 1
+                truncate_degree(tprod, 5)
+                self.assertEqual(dp.to_polynomial(), tprod)
+            dp.remove()
+
+            with self.assertRaises(ValueError) as cm:
+                len(dp)
+            err = cm.exception
+            self.assertTrue(
+                "the files of this disk polynomial have been removed" in str(err))
+
+            # The files in a temporary directory are
+            # removed together with the disk polynomial.
+            dp = mul_out_of_core(a, b, 1024)
+            d = dp.path
+            self.assertTrue(os.path.exists(d))
+            del dp
+            self.assertFalse(os.path.exists(d))
+
+            # User-provided path and filters.
+            with tempfile.TemporaryDirectory() as tmpdir:
+                dp = mul_out_of_core(a, b, 4096, path=tmpdir, max_degree=4)
+                self.assertTrue(all([degree(p) <= 4 for p in dp]))
+                dp2 = mul_out_of_core(a, b, 1 << 40, max_degree=4)
+                self.assertEqual(dp.to_polynomial(), dp2.to_polynomial())
+                if _obake_cpp_version_major > 1 or (_obake_cpp_version_major == 0 and _obake_cpp_version_minor >= 4):
+                    tprod = prod * 1
+                    truncate_degree(tprod, 4)
+                    self.assertEqual(dp.to_polynomial(), tprod)
+                dp.remove()
+                dp2.remove()
+                self.assertTrue(os.path.exists(tmpdir))
+
+                # Products written into the same path do
+                # not overwrite each other.
+                dp = mul_out_of_core(a, b, 4096, path=tmpdir, min_abs_cf=100)
+                full = mul_out_of_core(a, b, 4096, path=tmpdir)
+                self.assertNotEqual(dp.path, full.path)
+                self.assertEqual(os.path.dirname(dp.path), tmpdir)
+                self.assertEqual(os.path.dirname(full.path), tmpdir)
+                self.assertTrue(len(dp) < len(full))
+                self.assertEqual(full.to_polynomial(), prod)
+                self.assertTrue(all([abs(c) >= 100 for p in dp for c in _to_terms(p)[2]]))
+                dp.remove()
+                self.assertEqual(full.to_polynomial(), prod)
+                full.remove()
+                self.assertEqual(os.listdir(tmpdir), [])
+
+                # The files of a disk polynomial in a user-provided
+                # path are not removed on destruction.
+                dp = mul_out_of_core(a, b, 4096, path=tmpdir)
+                d = dp.path
+                del dp
+                self.assertTrue(os.path.exists(d))
+
+            # Error handling.
+            with self.assertRaises(ValueError) as cm:
+                mul_out_of_core(a, b, 0)
+            err = cm.exception
+            self.assertTrue(
+                "the memory budget for an out-of-core multiplication must be nonzero" in str(err))
+
+    def run_memory_budget_tests(self):
+        from itertools import product
+        from . import polynomial, make_polynomials, subs, memory_budget, set_memory_budget, get_memory_budget, estimate_product
+        from . import types, byte_size, PowerCache, truncated_pow, PolyMatrix, export_shared, export_shared_size, attach_shared
+        from .core import with_quadmath
+
+        self.assertEqual(get_memory_budget(), None)
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+            a = (x + y - 2 * z + 1)**4
+            b = (x - y + z - 3)**4
+
+            # NOTE: with few term pairs, the keys of
+            # the product are counted exactly.
+            n_terms, n_bytes = estimate_product(a, b)
+            self.assertEqual(n_terms, len(a * b))
+            self.assertTrue(n_bytes > 0)
+            ua = sum([x**i for i in range(100)], pt())
+            ub = sum([y**i for i in range(100)], pt())
+            n_terms, _ = estimate_product(ua, ub)
+            self.assertEqual(len(ua * ub), 10000)
+            self.assertEqual(n_terms, 10000)
+            n_terms, n_bytes = estimate_product(a, pt())
+            self.assertEqual(n_terms, 0)
+
+            # A skewed product: most term pairs produce the few
+            # keys of the square of sum(x**i), the remaining pairs
+            # produce distinct keys.
+            sa = sum([x**i for i in range(500)], pt()) + \
+                sum([y**i for i in range(1, 31)], pt())
+            sb = sum([x**i for i in range(500)], pt()) + \
+                sum([z**i for i in range(1, 31)], pt())
+            sp = sa * sb
+            self.assertEqual(len(sp), 31899)
+            n_terms, _ = estimate_product(sa, sb)
+            self.assertTrue(n_terms >= len(sp) // 2)
+            self.assertTrue(n_terms <= len(sa) * len(sb))
+            with memory_budget(byte_size(sp) // 8):
+                with self.assertRaises(MemoryError) as cm:
+                    sa * sb
+
+            # Small budget.
+            with memory_budget(16):
+                self.assertEqual(get_memory_budget(), 16)
+                fs = [lambda: a * b, lambda: a**10, lambda: subs(a, {'x': b}),
+                      lambda: PowerCache(a)[10], lambda: truncated_pow(
+                          a, 10, 20),
+                      lambda: PolyMatrix([[a, b]]) @ PolyMatrix(
+                          [[a], [b]]),
+                      lambda: pt().addmul(a, b), lambda: pt().submul(a, b, 5)]
+                if t[0] == types.packed_monomial and (t[1] in [types.double, types.integer] or (with_quadmath and t[1] == types.real128)):
+                    buf = bytearray(export_shared_size(b))
+                    export_shared(b, buf)
+                    s = attach_shared(buf)
+                    fs.append(lambda: a * s)
+                for f in fs:
+                    with self.assertRaises(MemoryError) as cm:
+                        f()
+                    err = cm.exception
+                    self.assertTrue("exceeds the memory budget" in str(err))
+                # Operations which do not need the
+                # budget check are unaffected.
+                self.assertEqual(a + b, b + a)
+
+            self.assertEqual(get_memory_budget(), None)
+
+            # Large budget.
+            with memory_budget(1 << 40):
+                self.assertEqual(a * b, b * a)
+                self.assertEqual(a**2, a * a)
+                self.assertEqual(subs(a, {'x': b}), subs(a, {'x': b}))
+
+        with self.assertRaises(ValueError) as cm:
+            set_memory_budget(0)
+        err = cm.exception
+        self.assertTrue(
+            "the memory budget must be a positive number of bytes, but a value of 0 was specified instead" in str(err))
+
+        set_memory_budget(None)
+
+    def run_interrupt_tests(self):
+        import _thread
+        from .core import _max_concurrency
+        from itertools import product
+        from . import polynomial, make_polynomials, types, subs, progress, set_progress_callback, get_progress_callback
+
+        self.assertEqual(get_progress_callback(), (None, 0.5))
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z, u = make_polynomials(pt, 'x', 'y', 'z', 'u')
+            a = (x + y + z + u + 1)**8
+            b = (x - y + 2*z - u + 3)**8
+
+            # The progress callback does not
+            # alter the results.
+            calls = []
+
+            def cb(op, frac, elapsed):
+                calls.append((op, frac, elapsed))
+
+            with progress(cb, 0.):
+                self.assertEqual(get_progress_callback(), (cb, 0.))
+                res = a * b
+                self.assertEqual(subs(res, {'u': x}), subs(a, {'u': x}) * subs(b, {'u': x}))
+
+            self.assertEqual(get_progress_callback(), (None, 0.5))
+            self.assertEqual(res, b * a)
+            for op, frac, elapsed in calls:
+                self.assertTrue(op in ['mul', 'subs'])
+                self.assertTrue(frac is None or 0. <= frac <= 1.)
+                self.assertTrue(elapsed >= 0.)
+
+            # NOTE: the operations can be interrupted
+            # only if there are worker threads.
+            if t[1] != types.double or _max_concurrency() < 2:
+                continue
+
+            # A large product, which is cancelled
+            # by the first invocation of the callback.
+            a = (x + y + z + u + 1)**20
+            b = a * 1
+
+            def raising_cb(op, frac, elapsed):
+                raise ValueError("cancelled")
+
+            with progress(raising_cb, 0.):
+                with self.assertRaises(ValueError) as cm:
+                    a * a
+                err = cm.exception
+                self.assertTrue("cancelled" in str(err))
+
+                with self.assertRaises(ValueError) as cm:
+                    b *= a
+                self.assertEqual(b, a)
+
+            # Interruption via SIGINT, raised by
+            # the first invocation of the callback.
+            def sigint_cb(op, frac, elapsed):
+                _thread.interrupt_main()
+
+            with progress(sigint_cb, 0.):
+                with self.assertRaises(KeyboardInterrupt):
+                    a * a
+
+        with self.assertRaises(TypeError) as cm:
+            set_progress_callback(1)
+        err = cm.exception
+        self.assertTrue(
+            "the progress callback must be either None or a callable" in str(err))
+
+        with self.assertRaises(ValueError) as cm:
+            set_progress_callback(None, -1.)
+        err = cm.exception
+        self.assertTrue(
+            "the interval between two invocations of the progress callback must be a finite non-negative number" in str(err))
+
+    def run_converters_tests(self):
+        from itertools import product
+        from . import polynomial, make_polynomials, types, to_sympy, from_sympy, to_dense, from_dense
+
+        key_cf_list = list(product(self.key_types, self.cf_types))
+
+        for t in key_cf_list:
+            pt = polynomial[t[0], t[1]]
+
+            x, y, z = make_polynomials(pt, 'x', 'y', 'z')
+            p = (x - 2 * y + 3 * z + 1)**4
+
+            # SymPy.
+            try:
+                import sympy
+
+                sx, sy, sz = sympy.symbols('x y z')
+                ex = to_sympy(p)
+                if t[1] in [types.integer, types.rational]:
+                    self.assertEqual(sympy.expand(
+                        ex - (sx - 2 * sy + 3 * sz + 1)**4), 0)
+                self.assertEqual(from_sympy(ex, pt), p)
+                self.assertEqual(from_sympy(sympy.Poly(ex, sz, sx, sy), pt), p)
+                self.assertEqual(to_sympy(pt()), 0)
+                self.assertEqual(float(to_sympy(pt(3))), 3.)
+                self.assertEqual(from_sympy(sympy.Integer(5), pt), pt(5))
+                self.assertEqual(from_sympy(0, pt), pt())
+                self.assertEqual(from_sympy(sx**2 * sy - 7, pt), x**2 * y - 7)
+                self.assertEqual(from_sympy((sx + sy)**2 - sx**2, pt), 2 * x * y + y**2)
+                self.assertEqual(from_sympy(sx - sx, pt), pt())
+
+                # Laurent monomials.
+                q = x**-2 * y + 3 * z**-1 - x * y**-3 + 1
+                self.assertEqual(from_sympy(to_sympy(q), pt), q)
+                self.assertEqual(from_sympy(sy / sx**2 + 3 / sz - sx / sy**3 + 1, pt), q)
+                self.assertEqual(from_sympy((sx + 1 / sx)**2, pt), x**2 + 2 + x**-2)
+
+                # Non-monomial factors.
+                for e in [sympy.sin(sx), sympy.sqrt(sx) + 1, sx**sy]:
+                    with self.assertRaises(ValueError) as cm:
+                        from_sympy(e, pt)
+                    err = cm.exception
+                    self.assertTrue(
+                        "cannot convert a sympy expression containing the non-monomial factor" in str(err))
+
+                if t[1] == types.rational:
+                    self.assertEqual(from_sympy(sympy.Rational(1, 3) * sx, pt), x / 3)
+
+                if t[1] == types.integer:
+                    with self.assertRaises(TypeError) as cm:
+                        from_sympy(sympy.Rational(1, 3) * sx, pt)
+                    err = cm.exception
+                    self.assertTrue("cannot convert an object of type" in str(err))
+
+                with self.assertRaises(TypeError) as cm:
+                    from_sympy(ex, 1)
+                err = cm.exception
+                self.assertTrue(
+                    "the input parameter 't' is a" in str(err))
+            except ImportError:
+                pass
+
+            # NumPy.
+            try:
+                import numpy as np
+
+                arr = to_dense(p)
+                self.assertEqual(arr.shape, (5, 5, 5))
+                self.assertEqual(arr[0, 0, 0], 1)
+                self.assertEqual(arr[1, 1, 0], -24)
+                self.assertEqual(arr[1, 1, 1], -144)
+                self.assertEqual(arr[4, 0, 0], 1)
+                self.assertEqual(arr[2, 2, 1], 0)
+                self.assertEqual(from_dense(arr, ['x', 'y', 'z'], pt), p)
+                # The axes can be given in any order.
+                self.assertEqual(from_dense(np.transpose(arr, (2, 0, 1)), ['z', 'x', 'y'], pt), p)
+                q = p * 1
+                q.metadata
+                self.assertEqual(to_dense(q).shape, (5, 5, 5))
+                self.assertEqual(to_dense(p, [5, 4, 4]).shape, (6, 5, 5))
+                self.assertEqual(from_dense(to_dense(p, [5, 4, 4]), ['x', 'y', 'z'], pt), p)
+                self.assertEqual(to_dense(pt(2)).shape, ())
+                self.assertEqual(from_dense(to_dense(pt(2)), [], pt), pt(2))
+                self.assertEqual(from_dense(np.zeros((2, 2)), ['x', 'y'], pt), pt())
+                self.assertEqual(from_dense(np.array([[1, 2], [0, 3]]), ['x', 'y'], pt), 1 + 2 * y + 3 * x * y)
+
+                if t[1] == types.double:
+                    self.assertEqual(arr.dtype, np.float64)
+                else:
+                    self.assertEqual(arr.dtype, object)
+
+                # Error handling.
+                with self.assertRaises(ValueError) as cm:
+                    to_dense(p, [3, 4, 4])
+                err = cm.exception
+                self.assertTrue(
+                    "the polynomial contains a term whose exponents are out of the bounds of the dense array" in str(err))
+
+                with self.assertRaises(ValueError) as cm:
+                    to_dense(p, [3, 4])
+                err = cm.exception
+                self.assertTrue(
+                    "the number of maximum degrees (2) differs from the number of symbols of the polynomial (3)" in str(err))
+
+                with self.assertRaises(ValueError) as cm:
+                    to_dense(x**-1)
+                err = cm.exception
+                self.assertTrue(
+                    "cannot convert a polynomial with negative exponents into a dense array" in str(err))
+
+                with self.assertRaises(ValueError) as cm:
+                    from_dense(arr, ['x', 'y'], pt)
+                err = cm.exception
+                self.assertTrue(
+                    "the number of dimensions of the array (3) differs from the number of symbols (2)" in str(err))
+
+                with self.assertRaises(ValueError) as cm:
+                    from_dense(arr, ['x', 'y', 'x'], pt)
+                err = cm.exception
+                self.assertTrue(
+                    "the list of symbols passed to a polynomial converter contains duplicates" in str(err))
+            except ImportError:
+                pass
+
 
 def run_test_suite():
     """Run the full test suite.
@@ -16,7 +16,10 @@
 
 #include <boost/container/container_fwd.hpp>
 
+#include <obake/config.hpp>
+#include <obake/math/degree.hpp>
 #include <obake/math/safe_cast.hpp>
+#include <obake/math/truncate_degree.hpp>
 #include <obake/symbols.hpp>
 #include <obake/tex_stream_insert.hpp>
 
@@ -88,6 +91,22 @@ inline T generic_deepcopy_wrapper(const T &x, const py::dict &)
     return x;
 }
 
+// The type representing the degree of the series type T.
+template <typename T>
+using series_degree_t = decltype(::obake::degree(::std::declval<const T &>()));
+
+// In-place degree truncation, regardless
+// of the obake version.
+template <typename T, typename U>
+inline void truncate_degree_in_place(T &x, const U &n)
+{
+#if (OBAKE_VERSION_MAJOR > 0) || (OBAKE_VERSION_MAJOR == 0 && OBAKE_VERSION_MINOR >= 4)
+    ::obake::truncate_degree(x, n);
+#else
+    x = ::obake::truncate_degree(x, n);
+#endif
+}
+
 } // namespace obake_py
 
 #endif